@@ -1,432 +1,1819 @@
 /*************************************************************************************
- 
-   Input: set of n rectangles 
-   Output: area of union of the input rectangles
+
+   Input: set of n rectangles
+   Output: area of union of the input rectangles (and its perimeter with -p)
    Time complexity: O(n*logn), where n is # of rectangles
       Sorting for segment tree construction -> O(n*logn)
       Sorting y endpoints of rectangles for scan line scanning -> O(n*logn)
       Scan in y-direction and area computation -> O(n)
-   Method: segment tree, scan line
+   Method: segment tree (../segment_tree/segment_tree.h), scan line, the sweep itself is
+      rec_union_area of area_rec.h
+   Perimeter: the tree also keeps the # of disjoint covered runs of x and whether the
+      ends of each node are covered; between two scan lines every run adds two vertical
+      edges, and every scan line adds the change of the covered length as horizontal
+      edges (bottoms are swept before tops at the same height so that touching edges
+      cancel)
+   Parallel mode (-t p): the y-range is split into p slabs holding about the same # of
+      scan lines, every slab is swept by its own thread over the rectangles clipped to
+      it (with its own endpoint compression and tree) and the slab areas are summed;
+      a slab also applies the bottoms lying on its upper boundary, so the horizontal
+      edges there are counted once, by the slab below
+   External mode (-e): for inputs larger than memory, the rectangles are streamed once,
+      their scan lines and x endpoints go to two external merge sorts (sorted runs in
+      temporary files), the merged x endpoints are compressed into the distinct x list
+      and the merged scan lines are swept straight from the runs; runs are merged
+      MERGE_FANIN at a time into longer runs as they pile up, so at most MERGE_FANIN
+      run files per level are open and memory is O(d+f*b) for d distinct x, fan-in f
+      and b records per merge block, independent of n; the records are written
+      O(log_f(n/RUN_SIZE)) times
+   Batch mode (-b): the input holds m sets of rectangles, each is answered on its own
+      by a pool of p threads (-t p, default 1) that take the next set as they finish;
+      every thread keeps one area_arena, so the vectors and the tree are allocated
+      once per thread and only grow to the largest set it met
+   Integer mode (-i): long long coordinates, equal endpoints are merged exactly (no
+      PRECISION), the tree keeps integer lengths and area and perimeter are summed in
+      __int128 and printed as integers, so the answer is exact and the sorts compare
+      integers only
+   Window mode (-w): after the rectangles come q query windows, each is answered by the
+      covered area inside it; one sweep over the scan lines of the rectangles and of
+      the windows, the tree (integral_augment) keeps the area swept so far by the
+      covered length of every node, so a window reads its area as the swept area
+      inside its x-range at its top minus the one at its bottom -> O((n+q)*log(n))
+   Contour mode (-c): the boundary cycles of the union, holes included; at every height
+      the horizontal contour edges are the x-runs a bottom newly covers (reported by
+      the tree before the insertion) and the ones a top leaves uncovered (after the
+      deletion), O(logn) per run; contiguous runs of one kind are one edge, every
+      edge end either closes the vertical edge rising from that x or starts a new one;
+      the edges are chained as they appear and a cycle is printed as soon as it
+      closes, so only the open chains crossing the scan line are kept
+      -> O(n*logn+p*logn) for p contour edges
+   Overlap mode (-o, -n to count only): every pair of rectangles whose interiors meet,
+      the scan lines are swept with tops first at one height (touching is no overlap),
+      a bottom reports the active x-intervals meeting its own before it is inserted:
+      those containing its left end, found as the intervals stored at the canonical
+      nodes on the path to that leaf, and those starting inside it, found through a
+      count tree over the left ends; removed intervals leave their lists lazily
+      -> O(n*logn+k) for k pairs, O(n*logn) counting only; with -t p a pair belongs
+      to the slab holding the higher of its two bottoms
+   Raster fast path: when every coordinate is an integer and the bounding box is at most
+      RASTER_SIDE cells per side, the default mode (with or without -p, -t) rasterizes
+      the union into bit-rows of 64 cells per word instead of sweeping: either every
+      rectangle ORs its run mask into its rows (O(sum of h*w/64)), or, if that would
+      touch more words than the grid has cells, the rows are built one by one from a
+      difference array of coverage depth over x (O(W*H+n)); the area is the popcount
+      of the rows and the perimeter the popcount of each row XOR its neighbor cell and
+      XOR the row below, both exact, so the output is the same as the sweep's; the raster
+      is only taken when its word operations stay below RASTER_FACTOR*n*log2(n), so few
+      large rectangles on a large grid are swept
+   Two-set mode (-s): after the rectangles of set A come m and the m rectangles of set
+      B; one sweep over the scan lines of both, the tree (twoset_augment) counts the
+      B intervals of a node on their own besides all of them, so every node knows its
+      length covered by A or B, by B and by both, and |A| = |A u B| - |B| + |A n B|
+      -> O((n+m)*log(n+m)), the cost of one union sweep
+   Depth mode (-d k): the area covered by exactly j rectangles for j = 1..k-1, and by
+      k or more; the tree (depth_augment) keeps for every node its length covered by
+      >= j intervals for all j <= k, so between two scan lines every depth adds its
+      length at the root times the gap -> O(n*k*logn), one sweep for all depths
 
  ************************************************************************************/
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 #include <vector>
 
+#include "area_rec.h"
+
 #define NDEBUG
 #define PRECISION 0.000001
+#define RUN_SIZE    (1<<20) // records sorted in memory per run of an external sort
+#define MERGE_BLOCK (1<<10) // records read at once from a run while merging
+#define MERGE_FANIN 64      // runs merged at once, bounds the open run files and merge blocks
+#define RASTER_SIDE 4096      // largest bounding box side, in cells, of the raster fast path
+#define RASTER_FACTOR 64      // raster word operations that cost as much as one n*log2(n) step of the sweep
 
 // --------------- class definition --------------- //
 
-// endpoint of an interval
-class endpoint
+// scan line carrying the x-range of its rectangle, record of the external sort
+class scan_event
+{
+    public:
+        double height;
+        double left_x, right_x;
+        bool   is_bottom;
+};
+
+// sorted run in a temporary file, read back in blocks while merging
+template <class record_type>
+class sorted_run
 {
     public:
-        void init( double v, int id, bool b ) { value = v; interval_id = id; is_left = b; }
+        sorted_run(void) { file = NULL; pos = 0; len = 0; level = 0; }
 
-        double value;       // endpoint coordinate, real value
-        int    interval_id; // id of interval_set
-        bool   is_left;     // true if left endpoint, false if right endpoint
+        FILE                    *file;
+        std::vector<record_type> block;
+        size_t                   pos, len;
+        unsigned                 level; // # of merges the records went through
 };
 
-class interval
+// external merge sort: records are buffered, sorted and written as runs of RUN_SIZE
+// records to temporary files, then merged through a heap of the run heads; as soon as
+// MERGE_FANIN runs share a level they are merged into one run of the next level, so at
+// most MERGE_FANIN-1 runs per level are kept and run_set is ordered by falling level
+template <class record_type>
+class external_sort
 {
     public:
-        interval(void) { left_x=0; right_x=0; is_zeroLength = false; }
+        external_sort( bool (*cmp)( const record_type &, const record_type & ) ) { less = cmp; }
 
-        double   rLeft_x, rRight_x; // real left x, real right x 
-        double   rLength;           // rRight_x minus rLeft_x
-        bool     is_zeroLength;
-        unsigned left_x, right_x;   // left x and right x after transformation
+        bool (*less)( const record_type &, const record_type & );
+
+        std::vector<record_type>               buffer;
+        std::vector< sorted_run<record_type> > run_set;
+        std::vector<unsigned>                  heap; // runs not exhausted, smallest head first
 };
 
-// tree node of the segment tree
-class node
+// vertex of a contour chain, a chain end has one link and knows the other end
+class contour_vertex
 {
     public:
-        node(void) 
-        { 
-            key            = 0;
-            leftChild_id   = 0; 
-            rightChild_id  = 0; 
-            intervalCount  = 0; 
-            subtreeRLength = 0.0;
-        }
+        double   x, y;
+        unsigned link[2];      // neighbours on the chain, 0 if none
+        unsigned other_end;    // for a chain end: the vertex at the other end of its chain
+        bool     is_coverUp;   // its horizontal edge has the union above it (bottom of the union)
+};
+
+// horizontal contour edge of the current height, leaves [low, high) of the tree
+class contour_piece
+{
+    public:
+        unsigned low, high;
+        bool     is_coverUp; // newly covered by a bottom, otherwise newly uncovered by a top
+};
+
+// open chains of the contour sweep
+class contour_state
+{
+    public:
+        contour_state(void) { pool.resize( 1 ); }
 
-        unsigned key;
-        double   rLeft_x, rRight_x; // real left x, real right x
-        double   rLength;           // rRight_x-rLeft_x
-        unsigned left_x, right_x; 
-        unsigned parent_id;    // 0 if it is root
-        unsigned leftChild_id, rightChild_id;
+        std::vector<contour_vertex> pool;    // (use +1 offset)
+        std::vector<unsigned>       free_id; // recycled vertex ids
+        std::vector<unsigned>       rising;  // [b]: lower vertex of the vertical edge rising from tree boundary b, 0 if none
+};
 
-        unsigned intervalCount;
-        double subtreeRLength; // interval length of the subtree
+// active x-intervals of the overlap sweep
+class overlap_index
+{
+    public:
+        segment_tree<double>                cover;       // canonical nodes of the active intervals, counts only
+        std::vector< std::vector<unsigned> > cover_list;  // [i]: intervals stored at node i (use +1 offset), with removed ones
+        std::vector<unsigned>                start_count; // [i]: # of active intervals starting in the leaves below node i
+        std::vector< std::vector<unsigned> > start_list;  // [j]: intervals starting at leaf j, with removed ones
+        std::vector<bool>                    is_active;   // (use +1 offset)
+        bool                                 is_report;   // keep the lists, otherwise count only
 };
 
-class scan_line
+// rectangle sets of batch mode, set s is rec_pool[set_begin[s]..set_begin[s+1])
+class batch_input
 {
     public:
-        double   height;      // y-coordinate
-        unsigned interval_id; // the interval being scanned now, id of interval == id of rectangle
-        bool     is_bottom;   // true if it is bottom of rectange, otherwise it is top
+        std::vector<rectangle> rec_pool;
+        std::vector<unsigned>  set_begin; // (use no offset)
 };
 
 // --------------- function declaration --------------- //
 
-bool cmp_small_epVal( const endpoint &e1, const endpoint &e2 );
+bool cmp_small_event( const scan_event &e1, const scan_event &e2 );
+
+bool cmp_small_real( const double &v1, const double &v2 );
+
+void slab_process( const std::vector<rectangle> &rec_set, double low_y, double high_y, double &area, double &perimeter );
+
+void slab_bound( const std::vector<rectangle> &rec_set, unsigned slab_no, std::vector<double> &bound );
+
+double parallel_area( const std::vector<rectangle> &rec_set, unsigned thread_no, double &perimeter );
+
+template <class record_type>
+void sort_spill( external_sort<record_type> &sorter );
+
+template <class record_type>
+void sort_push( external_sort<record_type> &sorter, const record_type &record );
+
+template <class record_type>
+bool run_fill( sorted_run<record_type> &run );
+
+template <class record_type>
+bool run_greater( const external_sort<record_type> &sorter, unsigned r1, unsigned r2 );
+
+template <class record_type>
+void merge_heap( external_sort<record_type> &sorter );
+
+template <class record_type>
+void run_merge( external_sort<record_type> &sorter, unsigned first_run );
+
+template <class record_type>
+void merge_start( external_sort<record_type> &sorter );
+
+template <class record_type>
+bool merge_next( external_sort<record_type> &sorter, record_type &record );
+
+template <class record_type>
+void merge_finish( external_sort<record_type> &sorter );
 
-bool cmp_small_slHeight( const scan_line &s1, const scan_line &s2 );
+double external_area( unsigned rec_no, double &perimeter );
 
-void tree_update( unsigned cur_id, std::vector<node> &segment_tree, double interval_length );
+void print_int128( __int128 value );
 
-void interval_deletion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, std::vector<node> &segment_tree );
+void window_area( const std::vector<rectangle> &rec_set, const std::vector<rectangle> &window_set,
+                  std::vector<double> &answer );
 
-void interval_insertion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, std::vector<node> &segment_tree );
+unsigned vertex_new( contour_state &state, double x, double y, bool is_coverUp );
 
-double report_curlength( node &root );
+void cycle_emit( contour_state &state, unsigned start_id );
 
-void tree_construct( std::vector<node> &segment_tree );
+void vertex_link( contour_state &state, unsigned v1, unsigned v2 );
+
+void contour_sweep( const std::vector<rectangle> &rec_set );
+
+bool cmp_small_ovHeight( const scan_line<double> &s1, const scan_line<double> &s2 );
+
+void overlap_insertion( overlap_index &index, unsigned id, unsigned left_x, unsigned right_x );
+
+void overlap_deletion( overlap_index &index, unsigned id, unsigned left_x, unsigned right_x );
+
+void list_report( std::vector<unsigned> &list, const std::vector<bool> &is_active, unsigned id,
+                  std::vector< std::pair<unsigned, unsigned> > &pair_set );
+
+void start_report( overlap_index &index, unsigned cur_id, unsigned low, unsigned high, unsigned target_low,
+                   unsigned target_high, unsigned id, std::vector< std::pair<unsigned, unsigned> > &pair_set );
+
+unsigned long long overlap_query( overlap_index &index, unsigned id, unsigned left_x, unsigned right_x,
+                                  std::vector< std::pair<unsigned, unsigned> > &pair_set );
+
+void overlap_slab( const std::vector<rectangle> &rec_set, double low_y, double high_y, bool is_report,
+                   std::vector< std::pair<unsigned, unsigned> > &pair_set, unsigned long long &pair_no );
+
+void overlap_report( const std::vector<rectangle> &rec_set, unsigned thread_no, bool is_report );
+
+void depth_area( const std::vector<rectangle> &rec_set, unsigned coverage_k, std::vector<double> &depth_set );
+
+void boolean_area( const std::vector<rectangle> &set_a, const std::vector<rectangle> &set_b, double &area_a,
+                   double &area_b, double &area_both, double &area_union );
+
+void raster_row( const unsigned long long *row, const unsigned long long *below, unsigned word_no,
+                 unsigned long long &cell_no, unsigned long long &edge_no );
+
+bool raster_area( const std::vector<rectangle> &rec_set, double &area, double &perimeter );
+
+void batch_worker( const batch_input &batch, std::atomic<unsigned> &next_set, std::vector<double> &set_area,
+                   std::vector<double> &set_perimeter );
+
+void batch_area( const batch_input &batch, unsigned thread_no, std::vector<double> &set_area,
+                 std::vector<double> &set_perimeter );
 
 using std::vector;
 
 // --------------- function definition --------------- //
 
-bool cmp_small_epVal( const endpoint &e1, const endpoint &e2 )
+// same order as cmp_small_slHeight
+bool cmp_small_event( const scan_event &e1, const scan_event &e2 )
+{
+    if( e1.height != e2.height )
+        return ( e1.height < e2.height );
+    else
+        return ( e1.is_bottom && !(e2.is_bottom) );
+}
+
+bool cmp_small_real( const double &v1, const double &v2 )
 {
-    return ( e1.value < e2.value );
+    return ( v1 < v2 );
 }
 
-bool cmp_small_slHeight( const scan_line &s1, const scan_line &s2 )
+void slab_process( const vector<rectangle> &rec_set, double low_y, double high_y, double &area, double &perimeter )
 {
-    // tie break is top of rectangle or not
-    if( fabs(s1.height-s2.height) < PRECISION )
-    {
-        if( !(s1.is_bottom) )
-            return true;
-        else
-            return false;
-    }
-    else if( s1.height < s2.height )
-        return true;
-    else
-        return false;
+    area_arena arena;
+    area = sweep_area( rec_set.data(), rec_set.size(), low_y, high_y, arena, perimeter );
 }
 
-// update towards root after insertion
-void tree_update( unsigned cur_id, vector<node> &segment_tree, double interval_length )
+// slab boundaries at the quantiles of the scan line heights, bound[0] and bound[slab_no] are infinite
+void slab_bound( const vector<rectangle> &rec_set, unsigned slab_no, vector<double> &bound )
 {
-    // has been inserted or hit the root
-    if( segment_tree[cur_id].intervalCount > 0 || cur_id == 1 )
+    vector<double> height( 2*rec_set.size() );
+
+    for( unsigned i=0; i<rec_set.size(); ++i )
     {
-        segment_tree[cur_id].subtreeRLength += interval_length;
-        return;
+        height[2*i]   = rec_set[i].bottom_y;
+        height[2*i+1] = rec_set[i].up_y;
     }
-    else
+
+    bound.assign( slab_no+1, HUGE_VAL );
+    bound[0] = -HUGE_VAL;
+
+    // every selection only looks at the part above the previous quantile
+    vector<double>::iterator first = height.begin();
+
+    for( unsigned s=1; s<slab_no && !height.empty(); ++s )
     {
-        segment_tree[cur_id].subtreeRLength += interval_length;
-        tree_update( segment_tree[cur_id].parent_id, segment_tree, interval_length );
+        vector<double>::iterator nth = height.begin() + height.size()*s/slab_no;
+        std::nth_element( first, nth, height.end() );
+        bound[s] = *nth;
+        first = nth;
     }
 
     return;
 }
 
-void interval_deletion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, vector<node> &segment_tree )
+// one thread per slab, the slab areas are summed in slab order so the result does not depend on timing
+double parallel_area( const vector<rectangle> &rec_set, unsigned thread_no, double &perimeter )
 {
-    if( (target_left_x <= segment_tree[cur_id].left_x) && (target_right_x >= segment_tree[cur_id].right_x) )
+    vector<double> bound;
+    slab_bound( rec_set, thread_no, bound );
+
+    vector<double>      slab_area( thread_no, 0.0 ), slab_perimeter( thread_no, 0.0 );
+    vector<std::thread> thread_set;
+
+    for( unsigned s=0; s<thread_no; ++s )
+        thread_set.push_back( std::thread( slab_process, std::cref(rec_set), bound[s], bound[s+1], std::ref(slab_area[s]),
+                                          std::ref(slab_perimeter[s]) ) );
+
+    double total_area = 0.0;
+    perimeter = 0.0;
+
+    for( unsigned s=0; s<thread_no; ++s )
     {
-        assert( segment_tree[cur_id].intervalCount > 0 );
-        (segment_tree[cur_id].intervalCount)--;
+        thread_set[s].join();
+        total_area += slab_area[s];
+        perimeter  += slab_perimeter[s];
+    }
 
-        if( segment_tree[cur_id].intervalCount == 0 && cur_id != 1 )
-            tree_update( segment_tree[cur_id].parent_id, segment_tree, segment_tree[cur_id].subtreeRLength-segment_tree[cur_id].rLength );
+    return total_area;
+}
 
+// sort the buffered records and write them as one run
+template <class record_type>
+void sort_spill( external_sort<record_type> &sorter )
+{
+    if( sorter.buffer.empty() )
         return;
+
+    std::sort( sorter.buffer.begin(), sorter.buffer.end(), sorter.less );
+
+    sorted_run<record_type> run;
+    run.file = tmpfile();
+
+    if( run.file == NULL || fwrite( &(sorter.buffer[0]), sizeof(record_type), sorter.buffer.size(), run.file ) != sorter.buffer.size() )
+    {
+        fprintf( stderr, "cannot write a temporary run file\n" );
+        exit( 1 );
     }
 
-    if( target_left_x < segment_tree[cur_id].key )
-        interval_deletion( target_left_x, target_right_x, segment_tree[cur_id].leftChild_id, segment_tree );
+    rewind( run.file );
+    sorter.run_set.push_back( run );
+    sorter.buffer.clear();
 
-    if( target_right_x > segment_tree[cur_id].key )
-        interval_deletion( target_left_x, target_right_x, segment_tree[cur_id].rightChild_id, segment_tree );
+    // the last MERGE_FANIN runs share a level if the first of them has the level of the last one
+    std::vector< sorted_run<record_type> > &run_set = sorter.run_set;
 
-    return;
+    while( run_set.size() >= MERGE_FANIN && run_set[run_set.size()-MERGE_FANIN].level == run_set.back().level )
+        run_merge( sorter, run_set.size()-MERGE_FANIN );
 }
 
-// insert an interval and do update towards root
-void interval_insertion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, vector<node> &segment_tree )
+template <class record_type>
+inline void sort_push( external_sort<record_type> &sorter, const record_type &record )
 {
-    if( (target_left_x <= segment_tree[cur_id].left_x) && (target_right_x >= segment_tree[cur_id].right_x) )
-    {
-        if( segment_tree[cur_id].intervalCount == 0 && cur_id != 1 )
-            tree_update( segment_tree[cur_id].parent_id, segment_tree, segment_tree[cur_id].rLength-segment_tree[cur_id].subtreeRLength );
+    sorter.buffer.push_back( record );
 
-        (segment_tree[cur_id].intervalCount)++;
-        return;
-    }
-
-    if( target_left_x < segment_tree[cur_id].key )
-        interval_insertion( target_left_x, target_right_x, segment_tree[cur_id].leftChild_id, segment_tree );
+    if( sorter.buffer.size() >= RUN_SIZE )
+        sort_spill( sorter );
+}
 
-    if( target_right_x > segment_tree[cur_id].key )
-        interval_insertion( target_left_x, target_right_x, segment_tree[cur_id].rightChild_id, segment_tree );
+// read the next block of a run, false if it is exhausted
+template <class record_type>
+bool run_fill( sorted_run<record_type> &run )
+{
+    run.block.resize( MERGE_BLOCK );
+    run.len = fread( &(run.block[0]), sizeof(record_type), MERGE_BLOCK, run.file );
+    run.pos = 0;
 
-    return;
+    return ( run.len > 0 );
 }
 
-double report_curlength( node &root )
+// heap order: the run with the larger head sinks
+template <class record_type>
+inline bool run_greater( const external_sort<record_type> &sorter, unsigned r1, unsigned r2 )
 {
-    if( root.intervalCount == 0 )
-        return root.subtreeRLength;
-    else
-        return root.rLength;
+    const sorted_run<record_type> &run1 = sorter.run_set[r1], &run2 = sorter.run_set[r2];
+
+    return sorter.less( run2.block[run2.pos], run1.block[run1.pos] );
 }
 
-// construct segment tree
-void tree_construct( vector<node> &segment_tree, vector<double> &map_to_real )
+// load the head block of every run and order the runs by their heads
+template <class record_type>
+void merge_heap( external_sort<record_type> &sorter )
 {
-    unsigned key, tree_size, right_id; // temporary variables
+    sorter.heap.clear();
 
-    for( unsigned i=1; i<segment_tree.size(); ++i )
+    for( unsigned r=0; r<sorter.run_set.size(); ++r )
     {
-        if( (segment_tree[i].right_x - segment_tree[i].left_x) <= 1 )
+        if( run_fill( sorter.run_set[r] ) )
+            sorter.heap.push_back( r );
+    }
+
+    for( unsigned i=sorter.heap.size()/2; i-- > 0; ) // heapify
+    {
+        for( unsigned cur=i, child; (child = 2*cur+1) < sorter.heap.size(); cur = child )
         {
-            // leaf does not need to calculate key value, default is 0
-            assert( (segment_tree[i].right_x - segment_tree[i].left_x) == 1 );
-            assert( segment_tree[i].leftChild_id == 0 && segment_tree[i].rightChild_id == 0 );
-            continue;
+            if( child+1 < sorter.heap.size() && run_greater( sorter, sorter.heap[child], sorter.heap[child+1] ) )
+                child++;
+
+            if( !run_greater( sorter, sorter.heap[cur], sorter.heap[child] ) )
+                break;
+
+            std::swap( sorter.heap[cur], sorter.heap[child] );
         }
+    }
+}
+
+// replace run_set[first_run..] by one run of the next level holding all their records
+template <class record_type>
+void run_merge( external_sort<record_type> &sorter, unsigned first_run )
+{
+    external_sort<record_type> group( sorter.less );
+    group.run_set.assign( sorter.run_set.begin()+first_run, sorter.run_set.end() );
+    sorter.run_set.resize( first_run );
+
+    sorted_run<record_type> run;
+    run.file  = tmpfile();
+    run.level = group.run_set[0].level+1;
+
+    merge_heap( group );
 
-        key = (segment_tree[i].left_x + segment_tree[i].right_x)/2;
-        segment_tree[i].key = key;
+    std::vector<record_type> block;
+    record_type              record;
+    bool                     is_ok = ( run.file != NULL );
 
-        tree_size = segment_tree.size();
-        segment_tree.resize( tree_size+2 );
-        right_id = tree_size+1;
+    block.reserve( MERGE_BLOCK );
 
-        segment_tree[i].leftChild_id  = tree_size;
-        segment_tree[i].rightChild_id = right_id;
+    while( is_ok && merge_next( group, record ) )
+    {
+        block.push_back( record );
 
-        // construct left sub-tree
-        segment_tree[tree_size].rLeft_x   = map_to_real[segment_tree[i].left_x];
-        segment_tree[tree_size].rRight_x  = map_to_real[key];
-        segment_tree[tree_size].rLength   = segment_tree[tree_size].rRight_x - segment_tree[tree_size].rLeft_x;
-        segment_tree[tree_size].left_x    = segment_tree[i].left_x;
-        segment_tree[tree_size].right_x   = key;
-        segment_tree[tree_size].parent_id = i;
+        if( block.size() == MERGE_BLOCK )
+        {
+            is_ok = ( fwrite( &(block[0]), sizeof(record_type), block.size(), run.file ) == block.size() );
+            block.clear();
+        }
+    }
 
-        // construct right sub-tree
-        segment_tree[right_id].rLeft_x   = map_to_real[key];
-        segment_tree[right_id].rRight_x  = map_to_real[segment_tree[i].right_x];
-        segment_tree[right_id].rLength   = segment_tree[right_id].rRight_x - segment_tree[right_id].rLeft_x;
-        segment_tree[right_id].left_x    = key;
-        segment_tree[right_id].right_x   = segment_tree[i].right_x;
-        segment_tree[right_id].parent_id = i;
+    if( !is_ok || ( !block.empty() && fwrite( &(block[0]), sizeof(record_type), block.size(), run.file ) != block.size() ) )
+    {
+        fprintf( stderr, "cannot write a temporary run file\n" );
+        exit( 1 );
     }
 
-    return;
+    merge_finish( group );
+    rewind( run.file );
+    sorter.run_set.push_back( run );
 }
 
+// spill the last records, free the sort buffer, merge the smallest runs until at most
+// MERGE_FANIN are left and load the head block of every run
+template <class record_type>
+void merge_start( external_sort<record_type> &sorter )
+{
+    sort_spill( sorter );
+    std::vector<record_type>().swap( sorter.buffer );
 
-// --------------- main function --------------- //
+    while( sorter.run_set.size() > MERGE_FANIN )
+        run_merge( sorter, sorter.run_set.size() - std::min<size_t>( MERGE_FANIN, sorter.run_set.size()-MERGE_FANIN+1 ) );
 
-int main( int argc, char **argv )
+    merge_heap( sorter );
+}
+
+// smallest record left, false if all runs are exhausted
+template <class record_type>
+bool merge_next( external_sort<record_type> &sorter, record_type &record )
 {
-    //freopen( "../rectangle_cases/case2.in", "r", stdin );
+    std::vector<unsigned> &heap = sorter.heap;
+
+    if( heap.empty() )
+        return false;
+
+    sorted_run<record_type> &run = sorter.run_set[heap[0]];
+    record = run.block[run.pos++];
+
+    if( run.pos == run.len && !run_fill( run ) )
+    {
+        heap[0] = heap.back();
+        heap.pop_back();
+    }
 
-    unsigned rec_no;  // # of rectangle
-    unsigned scan_no; // # of location to be scanned
+    // sift the (new) head down
+    for( unsigned cur=0, child; (child = 2*cur+1) < heap.size(); cur = child )
+    {
+        if( child+1 < heap.size() && run_greater( sorter, heap[child], heap[child+1] ) )
+            child++;
 
-    scanf( "%u", &rec_no );
-    scan_no = 2*rec_no;
+        if( !run_greater( sorter, heap[cur], heap[child] ) )
+            break;
 
-    // preprocess (resize) the input data: interval_set, endpoint_set, scan_line_set
-    vector<interval> interval_set;   // all intervals (use +1 offset)
-    interval_set.resize( rec_no+1 ); // each rectangle offers an interval
-    vector<endpoint> endpoint_set; // all endpoints (use no offset)
-    endpoint_set.resize( scan_no );
-    vector<scan_line> scan_line_set;
-    scan_line_set.resize( scan_no );
+        std::swap( heap[cur], heap[child] );
+    }
 
-    { // parse input 
-        double left_x, bottom_y, right_x, up_y;
-        unsigned e_id = 0;
-        rec_no+=1;
+    return true;
+}
 
-        for( unsigned i=1; i<rec_no; ++i )
-        {
-            scanf( "%lf", &left_x );
-            scanf( "%lf", &bottom_y );
-            scanf( "%lf", &right_x );
-            scanf( "%lf", &up_y );
+// temporary files are removed when closed
+template <class record_type>
+void merge_finish( external_sort<record_type> &sorter )
+{
+    for( unsigned r=0; r<sorter.run_set.size(); ++r )
+        fclose( sorter.run_set[r].file );
 
-            if( fabs( up_y-bottom_y ) < PRECISION || fabs( left_x-right_x ) < PRECISION )
-            {
-                rec_no--;
-                scan_no-=2;
-                interval_set.resize( rec_no );
-                endpoint_set.resize( scan_no );
-                scan_line_set.resize( scan_no );
-                i--;
+    sorter.run_set.clear();
+    sorter.heap.clear();
+}
+
+// stream rec_no rectangles from stdin, only the distinct x and the tree are kept in memory
+double external_area( unsigned rec_no, double &perimeter )
+{
+    external_sort<scan_event> event_sort( cmp_small_event );
+    external_sort<double>     x_sort( cmp_small_real );
+
+    { // pass 1: stream the input into the runs
+        rectangle  rec;
+        scan_event event;
 
+        for( unsigned i=0; i<rec_no; ++i )
+        {
+            if( scanf( "%lf %lf %lf %lf", &rec.left_x, &rec.bottom_y, &rec.right_x, &rec.up_y ) != 4 )
+                break;
+
+            if( fabs( rec.up_y-rec.bottom_y ) < PRECISION || fabs( rec.left_x-rec.right_x ) < PRECISION )
                 continue;
-            }
 
-            interval_set[i].rLeft_x = left_x;
-            scan_line_set[e_id].height = bottom_y;
-            scan_line_set[e_id].interval_id = i;
-            scan_line_set[e_id].is_bottom   = true;
-            endpoint_set[e_id++].init( interval_set[i].rLeft_x, i, true );
+            event.left_x    = rec.left_x;
+            event.right_x   = rec.right_x;
+            event.height    = rec.bottom_y;
+            event.is_bottom = true;
+            sort_push( event_sort, event );
+            event.height    = rec.up_y;
+            event.is_bottom = false;
+            sort_push( event_sort, event );
+
+            sort_push( x_sort, rec.left_x );
+            sort_push( x_sort, rec.right_x );
+        }
+    }
+
+    vector<double>   distinct_x;  // distinct real x in ascending order
+    vector<unsigned> mapped_x;    // mapped value of distinct_x[i]
+    vector<double>   map_to_real( 1, 0.0 ); // mapped space to real value, (use +1 offset)
 
-            interval_set[i].rRight_x = right_x;
-            scan_line_set[e_id].height = up_y;
-            scan_line_set[e_id].interval_id = i;
-            scan_line_set[e_id].is_bottom   = false;
-            endpoint_set[e_id++].init( interval_set[i].rRight_x, i, false );
+    { // pass 2: map the real space to integer space counting from integer 1, as compress_endpoints
+        double x;
+        merge_start( x_sort );
+
+        while( merge_next( x_sort, x ) )
+        {
+            if( !distinct_x.empty() && x == distinct_x.back() )
+                continue;
 
-            interval_set[i].rLength = interval_set[i].rRight_x - interval_set[i].rLeft_x;
-            assert( interval_set[i].rLength >= 0.0 );
+            if( distinct_x.empty() || x - distinct_x.back() > PRECISION )
+                map_to_real.push_back( x );
 
-            if( fabs( interval_set[i].rLength ) < PRECISION )
-                interval_set[i].is_zeroLength = true;
+            distinct_x.push_back( x );
+            mapped_x.push_back( map_to_real.size()-1 );
         }
 
-        rec_no-=1; // recover
+        merge_finish( x_sort );
     }
 
-    unsigned global_max_x; // max x of the mapped space, min x is 1
-    vector<double> map_to_real; // mapped space to real value, (use +1 offset)
-    map_to_real.resize( scan_no+1 );
+    perimeter = 0.0;
 
-    { // map the real space to integer space counting from integer 1
-        // sort endpoints in ascending order
-        std::sort( endpoint_set.begin(), endpoint_set.end(), cmp_small_epVal );
+    if( distinct_x.empty() )
+        return 0.0;
 
-        unsigned mapped_val = 1;
-        unsigned tmp_id = endpoint_set[0].interval_id;
-        map_to_real[1] = endpoint_set[0].value;
+    area_tree tree; // segment tree (use +1 offset)
+    tree_construct( tree, map_to_real, map_to_real.size()-1 );
 
-        if( endpoint_set[0].is_left )
-            interval_set[tmp_id].left_x  = mapped_val;
-        else
-            interval_set[tmp_id].right_x = mapped_val;
+    sweep_state state;
 
-        unsigned endpoint_no = endpoint_set.size();
+    { // pass 3: sweep the merged scan lines
+        scan_event event;
+        merge_start( event_sort );
 
-        for( unsigned i=1; i<endpoint_no; ++i )
+        while( merge_next( event_sort, event ) )
         {
-            // if two real values are the same, they should map to the same integer
-            // otherwise, just map to next continuous integer
-            if( fabs( endpoint_set[i].value - endpoint_set[i-1].value ) > PRECISION )
-            {
-                mapped_val++;
-                map_to_real[mapped_val] = endpoint_set[i].value;
-            }
+            unsigned left_x  = mapped_x[std::lower_bound( distinct_x.begin(), distinct_x.end(), event.left_x ) - distinct_x.begin()];
+            unsigned right_x = mapped_x[std::lower_bound( distinct_x.begin(), distinct_x.end(), event.right_x ) - distinct_x.begin()];
+
+            sweep_event( tree, state, event.height, left_x, right_x, event.is_bottom, true );
+        }
+
+        merge_finish( event_sort );
+    }
+
+    perimeter = state.perimeter;
+
+    return state.area;
+}
+
+// take the next unanswered set until none is left, all sets of this thread share one arena
+void batch_worker( const batch_input &batch, std::atomic<unsigned> &next_set, vector<double> &set_area,
+                   vector<double> &set_perimeter )
+{
+    area_arena arena;
+    unsigned   set_no = batch.set_begin.size()-1;
+
+    for( unsigned s = next_set++; s < set_no; s = next_set++ )
+    {
+        const rectangle *rec_set = batch.rec_pool.data() + batch.set_begin[s];
+        set_area[s] = rec_union_area( rec_set, batch.set_begin[s+1]-batch.set_begin[s], arena, set_perimeter[s] );
+    }
+}
+
+// every set is written by exactly one thread, the results keep the input order
+void batch_area( const batch_input &batch, unsigned thread_no, vector<double> &set_area, vector<double> &set_perimeter )
+{
+    unsigned set_no = batch.set_begin.size()-1;
+    set_area.assign( set_no, 0.0 );
+    set_perimeter.assign( set_no, 0.0 );
+
+    std::atomic<unsigned> next_set( 0 );
+    thread_no = std::max( 1u, std::min( thread_no, set_no ) );
+
+    if( thread_no == 1 )
+    {
+        batch_worker( batch, next_set, set_area, set_perimeter );
+        return;
+    }
+
+    vector<std::thread> thread_set;
+
+    for( unsigned t=0; t<thread_no; ++t )
+        thread_set.push_back( std::thread( batch_worker, std::cref(batch), std::ref(next_set), std::ref(set_area),
+                                          std::ref(set_perimeter) ) );
+
+    for( unsigned t=0; t<thread_no; ++t )
+        thread_set[t].join();
 
-            tmp_id = endpoint_set[i].interval_id;
+    return;
+}
+
+// printf has no conversion for __int128
+void print_int128( __int128 value )
+{
+    char digit[48];
+    int  digit_no = 0;
+    bool is_negative = ( value < 0 );
+
+    do
+    {
+        int d = static_cast<int>(value % 10);
+        digit[digit_no++] = '0' + ( d < 0 ? -d : d );
+        value /= 10;
+    } while( value != 0 );
+
+    if( is_negative )
+        putchar( '-' );
+
+    while( digit_no > 0 )
+        putchar( digit[--digit_no] );
+}
+
+// the windows are scan lines of the same sweep, a bottom subtracts the area swept below it and
+// the top adds the area swept below the top; events at one height commute, nothing is swept there
+void window_area( const vector<rectangle> &rec_set, const vector<rectangle> &window_set, vector<double> &answer )
+{
+    vector< interval<double> >  interval_set( rec_set.size()+1 ); // each rectangle offers an interval (use +1 offset)
+    vector< endpoint<double> >  endpoint_set( 2*rec_set.size() ); // all endpoints (use no offset)
+    vector< scan_line<double> > scan_line_set( 2*rec_set.size() );
+    vector< scan_line<double> > query_set( 2*window_set.size() ); // interval_id is the id of the window
+
+    answer.assign( window_set.size(), 0.0 );
+
+    for( unsigned i=0; i<rec_set.size(); ++i )
+    {
+        const rectangle &rec = rec_set[i];
+        interval_set[i+1].rLeft_x  = rec.left_x;
+        interval_set[i+1].rRight_x = rec.right_x;
+        interval_set[i+1].rLength  = rec.right_x - rec.left_x;
+        endpoint_set[2*i].init( rec.left_x, i+1, true );
+        endpoint_set[2*i+1].init( rec.right_x, i+1, false );
+
+        scan_line_set[2*i].height        = rec.bottom_y;
+        scan_line_set[2*i].interval_id   = i+1;
+        scan_line_set[2*i].is_bottom     = true;
+        scan_line_set[2*i+1].height      = rec.up_y;
+        scan_line_set[2*i+1].interval_id = i+1;
+        scan_line_set[2*i+1].is_bottom   = false;
+    }
+
+    for( unsigned i=0; i<window_set.size(); ++i )
+    {
+        query_set[2*i].height        = window_set[i].bottom_y;
+        query_set[2*i].interval_id   = i;
+        query_set[2*i].is_bottom     = true;
+        query_set[2*i+1].height      = window_set[i].up_y;
+        query_set[2*i+1].interval_id = i;
+        query_set[2*i+1].is_bottom   = false;
+    }
+
+    if( rec_set.empty() )
+        return;
+
+    vector<double> map_to_real; // mapped space to real value, (use +1 offset)
+    unsigned global_max_x = compress_endpoints( endpoint_set, interval_set, map_to_real ); // max x of the mapped space, min x is 1
+
+    segment_tree< double, integral_augment<double> > tree; // segment tree (use +1 offset)
+    tree_construct( tree, map_to_real, global_max_x );
+
+    std::sort( scan_line_set.begin(), scan_line_set.end(), cmp_small_slHeight<double> );
+    std::sort( query_set.begin(), query_set.end(), cmp_small_slHeight<double> );
 
-            if( endpoint_set[i].is_left )
-                interval_set[tmp_id].left_x  = mapped_val;
+    for( unsigned i=0, j=0; j<query_set.size(); )
+    {
+        if( i < scan_line_set.size() && scan_line_set[i].height <= query_set[j].height )
+        {
+            const scan_line<double> &target_line = scan_line_set[i++];
+            const interval<double> &target = interval_set[target_line.interval_id];
+
+            if( target_line.is_bottom )
+                integral_insertion( target.left_x, target.right_x, target_line.height, tree );
             else
-                interval_set[tmp_id].right_x = mapped_val;
+                integral_deletion( target.left_x, target.right_x, target_line.height, tree );
+        }
+        else
+        {
+            const scan_line<double> &query = query_set[j++];
+            const rectangle &window = window_set[query.interval_id];
+            double swept = window_integral( tree, map_to_real, global_max_x, window.left_x, window.right_x, query.height );
+
+            answer[query.interval_id] += query.is_bottom ? -swept : swept;
         }
+    }
 
-#ifndef NDEBUG
-        printf( "debug mapping..." );
+    return;
+}
+
+unsigned vertex_new( contour_state &state, double x, double y, bool is_coverUp )
+{
+    unsigned cur_id;
+
+    if( !state.free_id.empty() )
+    {
+        cur_id = state.free_id.back();
+        state.free_id.pop_back();
+    }
+    else
+    {
+        cur_id = state.pool.size();
+        state.pool.push_back( contour_vertex() );
+    }
+
+    contour_vertex &vertex = state.pool[cur_id];
+    vertex.x = x;
+    vertex.y = y;
+    vertex.link[0] = 0;
+    vertex.link[1] = 0;
+    vertex.other_end = cur_id;
+    vertex.is_coverUp = is_coverUp;
+
+    return cur_id;
+}
 
-        for( unsigned i=1; i<rec_no+1; ++i )
-            assert( interval_set[i].left_x > 0 && interval_set[i].right_x > 0 );
+// print a closed cycle and release its vertices; the lowest edge of a hole has the union
+// below it, outer cycles are printed counterclockwise and holes clockwise
+void cycle_emit( contour_state &state, unsigned start_id )
+{
+    vector<unsigned> cycle;
 
-        printf( "done!\n" );
-#endif 
-        global_max_x = mapped_val;
+    for( unsigned prev_id = 0, cur_id = start_id; ; )
+    {
+        cycle.push_back( cur_id );
+        const contour_vertex &cur = state.pool[cur_id];
+        unsigned next_id = ( cur.link[0] != prev_id ) ? cur.link[0] : cur.link[1];
+        prev_id = cur_id;
+        cur_id = next_id;
+
+        if( cur_id == start_id )
+            break;
     }
 
-    vector<node> segment_tree; // segment tree (use +1 offset)
+    unsigned lowest = 0;
+    double   twice_area = 0.0; // shoelace, positive if counterclockwise
+
+    for( unsigned i=0; i<cycle.size(); ++i )
+    {
+        const contour_vertex &v1 = state.pool[cycle[i]], &v2 = state.pool[cycle[(i+1)%cycle.size()]];
+        twice_area += v1.x*v2.y - v2.x*v1.y;
 
-    { // construct segment tree
-        segment_tree.resize(2);
-        segment_tree[1].rLeft_x   = map_to_real[1];
-        segment_tree[1].rRight_x  = map_to_real[global_max_x];
-        segment_tree[1].rLength   = segment_tree[1].rRight_x - segment_tree[1].rLeft_x;
-        segment_tree[1].left_x    = 1;
-        segment_tree[1].right_x   = global_max_x;
-        segment_tree[1].parent_id = 0;
-        tree_construct( segment_tree, map_to_real ); 
+        if( v1.y < state.pool[cycle[lowest]].y )
+            lowest = i;
     }
 
-    // sort height of scan lines in ascending order, top interval first if tie
-    std::sort( scan_line_set.begin(), scan_line_set.end(), cmp_small_slHeight );
+    bool is_hole = !state.pool[cycle[lowest]].is_coverUp;
 
-    vector<unsigned> interval_count; // record the interval count being inserted (use +1 offset)
-    interval_count.resize( rec_no+1, 0 );
-    unsigned target_id;              // target interval id
-    unsigned target_left_x, target_right_x;
+    if( (twice_area > 0.0) == is_hole )
+        std::reverse( cycle.begin(), cycle.end() );
 
-    double total_area=0.0;
-    double last_y, cur_y, length_y;
-    last_y = scan_line_set[0].height;
-    target_id = scan_line_set[0].interval_id;
-    assert( scan_line_set[0].is_bottom );
+    printf( "%s %u\n", is_hole ? "hole" : "outer", static_cast<unsigned>(cycle.size()) );
 
-    if( !(interval_set[target_id].is_zeroLength) )
+    for( unsigned i=0; i<cycle.size(); ++i )
     {
-        target_left_x  = interval_set[target_id].left_x;
-        target_right_x = interval_set[target_id].right_x;
-        interval_insertion( target_left_x, target_right_x, 1, segment_tree );
+        printf( "%lf %lf\n", state.pool[cycle[i]].x, state.pool[cycle[i]].y );
+        state.free_id.push_back( cycle[i] );
     }
+}
 
-    interval_count[target_id]++;
+// join two chain ends by an edge, a chain joined to its own other end is a closed cycle
+void vertex_link( contour_state &state, unsigned v1, unsigned v2 )
+{
+    contour_vertex &vertex1 = state.pool[v1], &vertex2 = state.pool[v2];
+    vertex1.link[vertex1.link[0] == 0 ? 0 : 1] = v2;
+    vertex2.link[vertex2.link[0] == 0 ? 0 : 1] = v1;
 
-    for( unsigned i=1; i<scan_no; ++i )
+    if( vertex1.other_end == v2 )
     {
-        const scan_line &target_line = scan_line_set[i];
-        target_id = target_line.interval_id;
+        cycle_emit( state, v1 );
+        return;
     }
 
-    for( unsigned i=1; i<scan_no; ++i )
+    unsigned end1 = vertex1.other_end, end2 = vertex2.other_end;
+    state.pool[end1].other_end = end2;
+    state.pool[end2].other_end = end1;
+}
+
+// one sweep over the heights; pieces of one height are merged through their end boundaries
+void contour_sweep( const vector<rectangle> &rec_set )
+{
+    vector< interval<double> >  interval_set( rec_set.size()+1 ); // each rectangle offers an interval (use +1 offset)
+    vector< endpoint<double> >  endpoint_set( 2*rec_set.size() ); // all endpoints (use no offset)
+    vector< scan_line<double> > scan_line_set( 2*rec_set.size() );
+
+    for( unsigned i=0; i<rec_set.size(); ++i )
     {
-        const scan_line &target_line = scan_line_set[i];
-        cur_y     = target_line.height;
-        target_id = target_line.interval_id;
-        length_y = cur_y - last_y;
-        assert( length_y >= 0.0 );
-        total_area += (length_y * report_curlength( segment_tree[1] ));
+        const rectangle &rec = rec_set[i];
+        interval_set[i+1].rLeft_x  = rec.left_x;
+        interval_set[i+1].rRight_x = rec.right_x;
+        interval_set[i+1].rLength  = rec.right_x - rec.left_x;
+        endpoint_set[2*i].init( rec.left_x, i+1, true );
+        endpoint_set[2*i+1].init( rec.right_x, i+1, false );
+
+        scan_line_set[2*i].height        = rec.bottom_y;
+        scan_line_set[2*i].interval_id   = i+1;
+        scan_line_set[2*i].is_bottom     = true;
+        scan_line_set[2*i+1].height      = rec.up_y;
+        scan_line_set[2*i+1].interval_id = i+1;
+        scan_line_set[2*i+1].is_bottom   = false;
+    }
 
-        if( target_line.is_bottom )
+    if( rec_set.empty() )
+        return;
+
+    vector<double> map_to_real; // mapped space to real value, (use +1 offset)
+    unsigned global_max_x = compress_endpoints( endpoint_set, interval_set, map_to_real ); // max x of the mapped space, min x is 1
+
+    segment_tree<double> tree; // segment tree (use +1 offset)
+    tree_construct( tree, map_to_real, global_max_x );
+
+    std::sort( scan_line_set.begin(), scan_line_set.end(), cmp_small_slHeight<double> );
+
+    contour_state state;
+    state.rising.assign( global_max_x, 0 );
+
+    // pieces of the current height by their end boundaries, valid if the stamp is the current height
+    vector<unsigned> piece_start( global_max_x ), piece_end( global_max_x );
+    vector<unsigned> start_stamp( global_max_x, 0 ), end_stamp( global_max_x, 0 );
+
+    vector< std::pair<unsigned, unsigned> > run_set;
+    vector<contour_piece> piece_set;
+    vector< std::pair<unsigned, unsigned> > new_rising; // (boundary, vertex) applied after the height
+
+    for( unsigned i=0, stamp=1; i<scan_line_set.size(); ++stamp )
+    {
+        double height = scan_line_set[i].height;
+        piece_set.clear();
+
+        // bottoms come first at one height, so a run is reported by one scan line only
+        for( ; i<scan_line_set.size() && scan_line_set[i].height == height; ++i )
         {
-            if( (interval_count[target_id]==0) && !(interval_set[target_id].is_zeroLength) )
+            const scan_line<double> &target_line = scan_line_set[i];
+            const interval<double> &target = interval_set[target_line.interval_id];
+
+            run_set.clear();
+
+            if( target_line.is_bottom )
+            {
+                uncovered_report( tree, 1, 0, tree.leaf_base, target.left_x-1, target.right_x-1, run_set );
+                interval_insertion( target.left_x, target.right_x, tree );
+            }
+            else
             {
-                target_left_x  = interval_set[target_id].left_x;
-                target_right_x = interval_set[target_id].right_x;
-                interval_insertion( target_left_x, target_right_x, 1, segment_tree );
+                interval_deletion( target.left_x, target.right_x, tree );
+                uncovered_report( tree, 1, 0, tree.leaf_base, target.left_x-1, target.right_x-1, run_set );
             }
 
-            interval_count[target_id]++;
+            for( unsigned r=0; r<run_set.size(); ++r )
+            {
+                contour_piece piece;
+                piece.low = run_set[r].first;
+                piece.high = run_set[r].second;
+                piece.is_coverUp = target_line.is_bottom;
+
+                piece_start[piece.low] = piece_set.size();
+                start_stamp[piece.low] = stamp;
+                piece_end[piece.high] = piece_set.size();
+                end_stamp[piece.high] = stamp;
+                piece_set.push_back( piece );
+            }
         }
-        else
+
+        new_rising.clear();
+
+        for( unsigned p=0; p<piece_set.size(); ++p )
         {
-            assert( interval_count[target_id]>0 );
+            const contour_piece &head = piece_set[p];
+            bool is_coverUp = head.is_coverUp;
+
+            // a run of one kind continuing another one is part of its edge
+            if( end_stamp[head.low] == stamp && piece_set[piece_end[head.low]].is_coverUp == is_coverUp )
+                continue;
+
+            unsigned high = head.high;
+
+            while( start_stamp[high] == stamp && piece_set[piece_start[high]].is_coverUp == is_coverUp )
+                high = piece_set[piece_start[high]].high;
+
+            unsigned left_id  = vertex_new( state, map_to_real[head.low+1], height, is_coverUp );
+            unsigned right_id = vertex_new( state, map_to_real[high+1], height, is_coverUp );
+            vertex_link( state, left_id, right_id );
 
-            if( interval_count[target_id]==1 )
+            // an end meeting a run of the other kind is a pinch: the edge below the union
+            // closes the vertical edge from below, the edge above the union starts a new one
+            bool is_leftPinch  = ( end_stamp[head.low] == stamp );
+            bool is_rightPinch = ( start_stamp[high] == stamp );
+            unsigned end_x[2]  = { head.low, high };
+            unsigned end_id[2] = { left_id, right_id };
+            bool     is_pinch[2] = { is_leftPinch, is_rightPinch };
+
+            for( unsigned e=0; e<2; ++e )
             {
-                target_left_x  = interval_set[target_id].left_x;
-                target_right_x = interval_set[target_id].right_x;
-                interval_deletion( target_left_x, target_right_x, 1, segment_tree );
-                interval_count[target_id]=0;
+                bool is_closing = is_pinch[e] ? !is_coverUp : ( state.rising[end_x[e]] != 0 );
+
+                if( is_closing )
+                {
+                    unsigned lower_id = state.rising[end_x[e]];
+                    assert( lower_id != 0 );
+                    state.rising[end_x[e]] = 0;
+                    vertex_link( state, lower_id, end_id[e] );
+                }
+                else
+                    new_rising.push_back( std::make_pair( end_x[e], end_id[e] ) );
             }
-            else
-                interval_count[target_id]--;
         }
 
-        last_y = cur_y;
+        for( unsigned r=0; r<new_rising.size(); ++r )
+        {
+            assert( state.rising[new_rising[r].first] == 0 );
+            state.rising[new_rising[r].first] = new_rising[r].second;
+        }
     }
 
-    printf( "%lf\n", total_area );
+    return;
+}
 
-    return 0;
+// tops first at one height, rectangles only touching there do not overlap
+bool cmp_small_ovHeight( const scan_line<double> &s1, const scan_line<double> &s2 )
+{
+    if( s1.height != s2.height )
+        return ( s1.height < s2.height );
+    else
+        return ( !(s1.is_bottom) && s2.is_bottom );
 }
 
+// [left_x, right_x] are mapped coordinates, the interval covers the leaves [left_x-1, right_x-1)
+void overlap_insertion( overlap_index &index, unsigned id, unsigned left_x, unsigned right_x )
+{
+    interval_insertion( left_x, right_x, index.cover );
+    index.is_active[id] = true;
+
+    unsigned leaf_base = index.cover.leaf_base;
+
+    for( unsigned cur_id = leaf_base+left_x-1; cur_id > 0; cur_id >>= 1 )
+        (index.start_count[cur_id])++;
+
+    if( !index.is_report )
+        return;
+
+    index.start_list[left_x-1].push_back( id );
+
+    // the canonical nodes, as interval_insertion finds them
+    for( unsigned left_id = leaf_base+left_x-1, right_id = leaf_base+right_x-1; left_id < right_id; left_id >>= 1, right_id >>= 1 )
+    {
+        if( left_id & 1 )
+            index.cover_list[left_id++].push_back( id );
+
+        if( right_id & 1 )
+            index.cover_list[--right_id].push_back( id );
+    }
+}
+
+// the lists keep the interval until a query passes it
+void overlap_deletion( overlap_index &index, unsigned id, unsigned left_x, unsigned right_x )
+{
+    interval_deletion( left_x, right_x, index.cover );
+    index.is_active[id] = false;
+
+    for( unsigned cur_id = index.cover.leaf_base+left_x-1; cur_id > 0; cur_id >>= 1 )
+        (index.start_count[cur_id])--;
+}
+
+// pair id with every active interval of the list, the removed ones are dropped on the way
+void list_report( vector<unsigned> &list, const vector<bool> &is_active, unsigned id, vector< std::pair<unsigned, unsigned> > &pair_set )
+{
+    for( unsigned i=0; i<list.size(); )
+    {
+        if( !is_active[list[i]] )
+        {
+            list[i] = list.back();
+            list.pop_back();
+            continue;
+        }
+
+        pair_set.push_back( std::make_pair( std::min( id, list[i] ), std::max( id, list[i] ) ) );
+        ++i;
+    }
+}
+
+// intervals starting in the leaves [target_low, target_high) below the node spanning the leaves [low, high)
+// only nodes with active starts are entered, O(logn) per leaf reported
+void start_report( overlap_index &index, unsigned cur_id, unsigned low, unsigned high, unsigned target_low,
+                   unsigned target_high, unsigned id, vector< std::pair<unsigned, unsigned> > &pair_set )
+{
+    if( target_high <= low || high <= target_low || index.start_count[cur_id] == 0 )
+        return;
+
+    if( cur_id >= index.cover.leaf_base )
+    {
+        list_report( index.start_list[low], index.is_active, id, pair_set );
+        return;
+    }
+
+    unsigned mid = (low+high)/2;
+    start_report( index, 2*cur_id, low, mid, target_low, target_high, id, pair_set );
+    start_report( index, 2*cur_id+1, mid, high, target_low, target_high, id, pair_set );
+}
+
+// active intervals meeting the open interval (left_x, right_x): the ones containing the leaf
+// starting at left_x, and the ones starting at left_x+1 .. right_x-1; returns their #
+unsigned long long overlap_query( overlap_index &index, unsigned id, unsigned left_x, unsigned right_x,
+                                  vector< std::pair<unsigned, unsigned> > &pair_set )
+{
+    unsigned leaf_base = index.cover.leaf_base;
+    unsigned long long pair_no = 0;
+
+    for( unsigned cur_id = leaf_base+left_x-1; cur_id > 0; cur_id >>= 1 )
+    {
+        pair_no += index.cover.intervalCount[cur_id];
+
+        if( index.is_report )
+            list_report( index.cover_list[cur_id], index.is_active, id, pair_set );
+    }
+
+    // # of starts in the leaves [left_x, right_x-1), bottom-up as interval_insertion
+    for( unsigned left_id = leaf_base+left_x, right_id = leaf_base+right_x-1; left_id < right_id; left_id >>= 1, right_id >>= 1 )
+    {
+        if( left_id & 1 )
+            pair_no += index.start_count[left_id++];
+
+        if( right_id & 1 )
+            pair_no += index.start_count[--right_id];
+    }
+
+    if( index.is_report )
+        start_report( index, 1, 0, leaf_base, left_x, right_x-1, id, pair_set );
+
+    return pair_no;
+}
+
+// pairs whose higher bottom lies in [low_y, high_y), ids are 1-based input positions;
+// the rectangles already open at low_y are inserted first without reporting
+void overlap_slab( const vector<rectangle> &rec_set, double low_y, double high_y, bool is_report,
+                   vector< std::pair<unsigned, unsigned> > &pair_set, unsigned long long &pair_no )
+{
+    vector< interval<double> >  interval_set( rec_set.size()+1 ); // (use +1 offset)
+    vector< endpoint<double> >  endpoint_set;                     // (use no offset)
+    vector< scan_line<double> > scan_line_set;
+    vector<unsigned>            open_set;                         // ids open at low_y
+
+    pair_set.clear();
+    pair_no = 0;
+
+    for( unsigned i=0; i<rec_set.size(); ++i )
+    {
+        const rectangle &rec = rec_set[i];
+
+        // empty interior, or not in the slab
+        if( !(rec.left_x < rec.right_x && rec.bottom_y < rec.up_y) || !(rec.bottom_y < high_y && rec.up_y > low_y) )
+            continue;
+
+        unsigned id = i+1;
+        interval_set[id].rLeft_x  = rec.left_x;
+        interval_set[id].rRight_x = rec.right_x;
+        interval_set[id].rLength  = rec.right_x - rec.left_x;
+
+        endpoint_set.push_back( endpoint<double>() );
+        endpoint_set.back().init( rec.left_x, id, true );
+        endpoint_set.push_back( endpoint<double>() );
+        endpoint_set.back().init( rec.right_x, id, false );
+
+        scan_line<double> line;
+        line.interval_id = id;
+
+        if( rec.bottom_y < low_y )
+            open_set.push_back( id );
+        else
+        {
+            line.height    = rec.bottom_y;
+            line.is_bottom = true;
+            scan_line_set.push_back( line );
+        }
+
+        if( rec.up_y < high_y )
+        {
+            line.height    = rec.up_y;
+            line.is_bottom = false;
+            scan_line_set.push_back( line );
+        }
+    }
+
+    if( endpoint_set.empty() )
+        return;
+
+    vector<double> map_to_real; // mapped space to real value, (use +1 offset)
+    unsigned global_max_x = compress_endpoints( endpoint_set, interval_set, map_to_real ); // max x of the mapped space, min x is 1
+
+    overlap_index index;
+    index.is_report = is_report;
+    tree_construct( index.cover, map_to_real, global_max_x );
+    index.start_count.assign( 2*index.cover.leaf_base, 0 );
+    index.is_active.assign( rec_set.size()+1, false );
+
+    if( is_report )
+    {
+        index.cover_list.resize( 2*index.cover.leaf_base );
+        index.start_list.resize( index.cover.leaf_base );
+    }
+
+    for( unsigned i=0; i<open_set.size(); ++i )
+        overlap_insertion( index, open_set[i], interval_set[open_set[i]].left_x, interval_set[open_set[i]].right_x );
+
+    std::sort( scan_line_set.begin(), scan_line_set.end(), cmp_small_ovHeight );
+
+    for( unsigned i=0; i<scan_line_set.size(); ++i )
+    {
+        const scan_line<double> &target_line = scan_line_set[i];
+        const interval<double> &target = interval_set[target_line.interval_id];
+
+        // merged endpoints may leave an interval no leaf, it meets nothing
+        if( target.left_x >= target.right_x )
+            continue;
+
+        if( target_line.is_bottom )
+        {
+            pair_no += overlap_query( index, target_line.interval_id, target.left_x, target.right_x, pair_set );
+            overlap_insertion( index, target_line.interval_id, target.left_x, target.right_x );
+        }
+        else
+            overlap_deletion( index, target_line.interval_id, target.left_x, target.right_x );
+    }
+
+    return;
+}
+
+// one slab per thread as parallel_area, the pairs are printed in slab order
+void overlap_report( const vector<rectangle> &rec_set, unsigned thread_no, bool is_report )
+{
+    vector<double> bound( 2 );
+    bound[0] = -HUGE_VAL;
+    bound[1] = HUGE_VAL;
+
+    if( thread_no > 1 )
+        slab_bound( rec_set, thread_no, bound );
+
+    unsigned slab_no = bound.size()-1;
+    vector< vector< std::pair<unsigned, unsigned> > > pair_set( slab_no );
+    vector<unsigned long long> pair_no( slab_no, 0 );
+
+    if( slab_no == 1 )
+        overlap_slab( rec_set, bound[0], bound[1], is_report, pair_set[0], pair_no[0] );
+    else
+    {
+        vector<std::thread> thread_set;
+
+        for( unsigned s=0; s<slab_no; ++s )
+            thread_set.push_back( std::thread( overlap_slab, std::cref(rec_set), bound[s], bound[s+1], is_report,
+                                              std::ref(pair_set[s]), std::ref(pair_no[s]) ) );
+
+        for( unsigned s=0; s<slab_no; ++s )
+            thread_set[s].join();
+    }
+
+    unsigned long long total_no = 0;
+
+    for( unsigned s=0; s<slab_no; ++s )
+    {
+        total_no += pair_no[s];
+
+        for( unsigned i=0; i<pair_set[s].size(); ++i )
+            printf( "%u %u\n", pair_set[s][i].first, pair_set[s][i].second );
+    }
+
+    if( !is_report )
+        printf( "%llu\n", total_no );
+}
+
+// depth_set[j-1] is the area covered by exactly j rectangles for j < coverage_k, and the last one
+// the area covered by coverage_k or more
+void depth_area( const vector<rectangle> &rec_set, unsigned coverage_k, vector<double> &depth_set )
+{
+    vector< interval<double> >  interval_set( rec_set.size()+1 ); // each rectangle offers an interval (use +1 offset)
+    vector< endpoint<double> >  endpoint_set( 2*rec_set.size() ); // all endpoints (use no offset)
+    vector< scan_line<double> > scan_line_set( 2*rec_set.size() );
+
+    depth_set.assign( coverage_k, 0.0 );
+
+    if( rec_set.empty() )
+        return;
+
+    for( unsigned i=0; i<rec_set.size(); ++i )
+    {
+        const rectangle &rec = rec_set[i];
+        interval_set[i+1].rLeft_x  = rec.left_x;
+        interval_set[i+1].rRight_x = rec.right_x;
+        interval_set[i+1].rLength  = rec.right_x - rec.left_x;
+        endpoint_set[2*i].init( rec.left_x, i+1, true );
+        endpoint_set[2*i+1].init( rec.right_x, i+1, false );
+
+        scan_line_set[2*i].height        = rec.bottom_y;
+        scan_line_set[2*i].interval_id   = i+1;
+        scan_line_set[2*i].is_bottom     = true;
+        scan_line_set[2*i+1].height      = rec.up_y;
+        scan_line_set[2*i+1].interval_id = i+1;
+        scan_line_set[2*i+1].is_bottom   = false;
+    }
+
+    vector<double> map_to_real; // mapped space to real value, (use +1 offset)
+    unsigned global_max_x = compress_endpoints( endpoint_set, interval_set, map_to_real ); // max x of the mapped space, min x is 1
+
+    segment_tree< double, depth_augment<double> > tree; // segment tree (use +1 offset)
+    tree.augment.coverage_k = coverage_k;
+    tree_construct( tree, map_to_real, global_max_x );
+
+    std::sort( scan_line_set.begin(), scan_line_set.end(), cmp_small_slHeight<double> );
+
+    vector<double> at_least( coverage_k+1, 0.0 ); // [j]: area covered by >= j rectangles, at_least[0] unused
+
+    for( unsigned i=0; i<scan_line_set.size(); ++i )
+    {
+        const scan_line<double> &target_line = scan_line_set[i];
+        const interval<double> &target = interval_set[target_line.interval_id];
+
+        if( i > 0 )
+        {
+            double gap = target_line.height - scan_line_set[i-1].height;
+
+            for( unsigned depth=1; depth<=coverage_k; ++depth )
+                at_least[depth] += gap * depth_length( tree, 1, depth );
+        }
+
+        if( target_line.is_bottom )
+            interval_insertion( target.left_x, target.right_x, tree );
+        else
+            interval_deletion( target.left_x, target.right_x, tree );
+    }
+
+    for( unsigned depth=1; depth<coverage_k; ++depth )
+        depth_set[depth-1] = at_least[depth] - at_least[depth+1];
+
+    depth_set[coverage_k-1] = at_least[coverage_k];
+
+    return;
+}
+
+// the rectangles of set_b get the ids after those of set_a
+void boolean_area( const vector<rectangle> &set_a, const vector<rectangle> &set_b, double &area_a,
+                   double &area_b, double &area_both, double &area_union )
+{
+    unsigned rec_no = set_a.size() + set_b.size();
+
+    vector< interval<double> >  interval_set( rec_no+1 ); // each rectangle offers an interval (use +1 offset)
+    vector< endpoint<double> >  endpoint_set( 2*rec_no ); // all endpoints (use no offset)
+    vector< scan_line<double> > scan_line_set( 2*rec_no );
+
+    area_a = area_b = area_both = area_union = 0.0;
+
+    if( rec_no == 0 )
+        return;
+
+    for( unsigned i=0; i<rec_no; ++i )
+    {
+        const rectangle &rec = ( i < set_a.size() ) ? set_a[i] : set_b[i-set_a.size()];
+        interval_set[i+1].rLeft_x  = rec.left_x;
+        interval_set[i+1].rRight_x = rec.right_x;
+        interval_set[i+1].rLength  = rec.right_x - rec.left_x;
+        endpoint_set[2*i].init( rec.left_x, i+1, true );
+        endpoint_set[2*i+1].init( rec.right_x, i+1, false );
+
+        scan_line_set[2*i].height        = rec.bottom_y;
+        scan_line_set[2*i].interval_id   = i+1;
+        scan_line_set[2*i].is_bottom     = true;
+        scan_line_set[2*i+1].height      = rec.up_y;
+        scan_line_set[2*i+1].interval_id = i+1;
+        scan_line_set[2*i+1].is_bottom   = false;
+    }
+
+    vector<double> map_to_real; // mapped space to real value, (use +1 offset)
+    unsigned global_max_x = compress_endpoints( endpoint_set, interval_set, map_to_real ); // max x of the mapped space, min x is 1
+
+    segment_tree< double, twoset_augment<double> > tree; // segment tree (use +1 offset)
+    tree_construct( tree, map_to_real, global_max_x );
+
+    std::sort( scan_line_set.begin(), scan_line_set.end(), cmp_small_slHeight<double> );
+
+    for( unsigned i=0; i<scan_line_set.size(); ++i )
+    {
+        const scan_line<double> &target_line = scan_line_set[i];
+        const interval<double> &target = interval_set[target_line.interval_id];
+        bool is_setB = ( target_line.interval_id > set_a.size() );
+
+        if( i > 0 )
+        {
+            double gap = target_line.height - scan_line_set[i-1].height;
+
+            area_union += gap * covered_length( tree, 1 );
+            area_b     += gap * setB_length( tree, 1 );
+            area_both  += gap * both_length( tree, 1 );
+        }
+
+        if( target_line.is_bottom )
+            set_insertion( target.left_x, target.right_x, is_setB, tree );
+        else
+            set_deletion( target.left_x, target.right_x, is_setB, tree );
+    }
+
+    area_a = area_union - area_b + area_both;
+
+    return;
+}
+
+// covered cells of the row, and the unit edges between a covered and an uncovered cell on the
+// left of each cell and below it; the last word always has a free bit past the right end
+void raster_row( const unsigned long long *row, const unsigned long long *below, unsigned word_no,
+                 unsigned long long &cell_no, unsigned long long &edge_no )
+{
+    unsigned long long carry = 0; // last cell of the previous word, in bit 0
+
+    for( unsigned w=0; w<word_no; ++w )
+    {
+        cell_no += __builtin_popcountll( row[w] );
+        edge_no += __builtin_popcountll( row[w] ^ ((row[w] << 1) | carry) );
+        edge_no += __builtin_popcountll( row[w] ^ below[w] );
+        carry = row[w] >> 63;
+    }
+}
+
+// false if the rectangles are not on a small integer grid or the raster would cost more than
+// the sweep, the caller sweeps them then
+bool raster_area( const vector<rectangle> &rec_set, double &area, double &perimeter )
+{
+    if( rec_set.empty() )
+        return false;
+
+    double min_x = rec_set[0].left_x, max_x = rec_set[0].right_x;
+    double min_y = rec_set[0].bottom_y, max_y = rec_set[0].up_y;
+
+    for( unsigned i=0; i<rec_set.size(); ++i )
+    {
+        const rectangle &rec = rec_set[i];
+
+        if( rec.left_x != floor( rec.left_x ) || rec.right_x != floor( rec.right_x ) ||
+            rec.bottom_y != floor( rec.bottom_y ) || rec.up_y != floor( rec.up_y ) )
+            return false;
+
+        min_x = std::min( min_x, rec.left_x );
+        max_x = std::max( max_x, rec.right_x );
+        min_y = std::min( min_y, rec.bottom_y );
+        max_y = std::max( max_y, rec.up_y );
+    }
+
+    if( max_x-min_x > RASTER_SIDE || max_y-min_y > RASTER_SIDE )
+        return false;
+
+    unsigned width = static_cast<unsigned>(max_x-min_x), height = static_cast<unsigned>(max_y-min_y);
+    unsigned word_no = width/64 + 1; // words per row, one bit to spare past the right end
+
+    double mask_cost = 0.0; // words touched by the run masks
+    for( unsigned i=0; i<rec_set.size(); ++i )
+        mask_cost += (rec_set[i].up_y-rec_set[i].bottom_y) * ((rec_set[i].right_x-rec_set[i].left_x)/64 + 2);
+
+    // the cheaper raster path and the popcount pass against the sweep
+    double raster_cost = std::min( mask_cost, static_cast<double>(width)*height ) + (height+1.0)*word_no;
+    double sweep_cost  = RASTER_FACTOR * rec_set.size() * log2( rec_set.size()+1.0 );
+
+    if( raster_cost > sweep_cost )
+        return false;
+
+    unsigned long long cell_no = 0, edge_no = 0;
+    vector<unsigned long long> zero_row( word_no, 0 );
+
+    if( mask_cost <= static_cast<double>(width)*height )
+    {
+        vector<unsigned long long> grid( static_cast<size_t>(height)*word_no, 0 ); // row y at y*word_no
+
+        for( unsigned i=0; i<rec_set.size(); ++i )
+        {
+            const rectangle &rec = rec_set[i];
+            unsigned x1 = static_cast<unsigned>(rec.left_x-min_x), x2 = static_cast<unsigned>(rec.right_x-min_x); // cells [x1, x2)
+            unsigned y1 = static_cast<unsigned>(rec.bottom_y-min_y), y2 = static_cast<unsigned>(rec.up_y-min_y);
+            unsigned first = x1/64, last = (x2-1)/64;
+            unsigned long long first_mask = ~0ULL << (x1%64), last_mask = ~0ULL >> (63-(x2-1)%64);
+
+            if( first == last )
+                first_mask = last_mask = first_mask & last_mask;
+
+            for( unsigned y=y1; y<y2; ++y )
+            {
+                unsigned long long *row = &(grid[static_cast<size_t>(y)*word_no]);
+                row[first] |= first_mask;
+
+                for( unsigned w=first+1; w<last; ++w )
+                    row[w] = ~0ULL;
+
+                row[last] |= last_mask;
+            }
+        }
+
+        for( unsigned y=0; y<=height; ++y )
+            raster_row( y < height ? &(grid[static_cast<size_t>(y)*word_no]) : zero_row.data(),
+                        y > 0 ? &(grid[static_cast<size_t>(y-1)*word_no]) : zero_row.data(), word_no, cell_no, edge_no );
+    }
+    else
+    {
+        vector< vector<unsigned> > row_event( height+1 ); // [y]: rectangles with bottom or top at y (use no offset)
+        vector<int>                col_diff( width+1, 0 ); // coverage depth of cell x is the sum of col_diff[0..x]
+        vector<unsigned long long> row( word_no, 0 ), below( word_no, 0 );
+
+        for( unsigned i=0; i<rec_set.size(); ++i )
+        {
+            row_event[static_cast<unsigned>(rec_set[i].bottom_y-min_y)].push_back( i );
+            row_event[static_cast<unsigned>(rec_set[i].up_y-min_y)].push_back( i );
+        }
+
+        for( unsigned y=0; y<=height; ++y )
+        {
+            for( unsigned j=0; j<row_event[y].size(); ++j )
+            {
+                const rectangle &rec = rec_set[row_event[y][j]];
+                int sign = ( rec.bottom_y-min_y == y ) ? 1 : -1;
+                col_diff[static_cast<unsigned>(rec.left_x-min_x)]  += sign;
+                col_diff[static_cast<unsigned>(rec.right_x-min_x)] -= sign;
+            }
+
+            std::fill( row.begin(), row.end(), 0 );
+
+            for( unsigned x=0, depth=0; x<width; ++x )
+            {
+                depth += col_diff[x];
+
+                if( depth > 0 )
+                    row[x/64] |= 1ULL << (x%64);
+            }
+
+            raster_row( row.data(), below.data(), word_no, cell_no, edge_no );
+            row.swap( below );
+        }
+    }
+
+    area = static_cast<double>(cell_no);
+    perimeter = static_cast<double>(edge_no);
+
+    return true;
+}
+
+// --------------- main function --------------- //
+
+// usage: area_rec [-p] [-t p] [-e | -b | -i | -w | -c | -o | -n | -d k | -s]
+//   -p   also report the perimeter of the union
+//   -t p split the y-range into p slabs swept by p threads (build with -pthread)
+//   -e   external mode, the rectangles are never held in memory (ignores -t)
+//   -b   batch mode, input is m and then m sets given as n and n rectangles, one line
+//        of output per set; -t p answers p sets at a time
+//   -i   integer mode, exact area of long long coordinates (ignores -t)
+//   -w   window mode, the rectangles are followed by q and q windows, one line of
+//        output per window with the covered area inside it (ignores -p and -t)
+//   -c   contour mode, prints every boundary cycle of the union as "outer k" or "hole k"
+//        and its k vertices, as soon as the sweep closes it (ignores -p and -t)
+//   -o   overlap mode, prints every pair of rectangles whose interiors meet as their
+//        1-based input positions, smaller first; -t p sweeps p slabs in parallel
+//   -n   as -o, but only prints the # of such pairs
+//   -d k depth mode, prints k lines "j area": the area covered by exactly j rectangles
+//        for j < k and, on the last line, by k or more (ignores -p and -t)
+//   -s   two-set mode, the rectangles (set A) are followed by m and the m rectangles of
+//        set B, prints "|A| |B| |A n B| |A u B| IoU" with IoU = |A n B|/|A u B| (0 if
+//        the union is empty) (ignores -p and -t)
+int main( int argc, char **argv )
+{
+    //freopen( "../rectangle_cases/case2.in", "r", stdin );
+
+    unsigned thread_no = 0;
+    bool     with_perimeter = false;
+    bool     is_external = false;
+    bool     is_batch = false;
+    bool     is_integer = false;
+    bool     is_window = false;
+    bool     is_contour = false;
+    bool     is_overlap = false, is_overlapCount = false;
+    unsigned coverage_k = 0; // depth cap of -d, 0 if not asked
+    bool     is_twoSet = false;
+
+    for( int i=1; i<argc; ++i )
+    {
+        if( strcmp( argv[i], "-t" ) == 0 && i+1 < argc )
+        {
+            thread_no = static_cast<unsigned>(atoi( argv[++i] ));
+
+            if( thread_no == 0 )
+                thread_no = 1;
+        }
+        else if( strcmp( argv[i], "-p" ) == 0 )
+            with_perimeter = true;
+        else if( strcmp( argv[i], "-e" ) == 0 )
+            is_external = true;
+        else if( strcmp( argv[i], "-b" ) == 0 )
+            is_batch = true;
+        else if( strcmp( argv[i], "-i" ) == 0 )
+            is_integer = true;
+        else if( strcmp( argv[i], "-w" ) == 0 )
+            is_window = true;
+        else if( strcmp( argv[i], "-c" ) == 0 )
+            is_contour = true;
+        else if( strcmp( argv[i], "-o" ) == 0 )
+            is_overlap = true;
+        else if( strcmp( argv[i], "-n" ) == 0 )
+            is_overlapCount = true;
+        else if( strcmp( argv[i], "-d" ) == 0 && i+1 < argc )
+        {
+            coverage_k = static_cast<unsigned>(atoi( argv[++i] ));
+
+            if( coverage_k == 0 )
+                coverage_k = 1;
+        }
+        else if( strcmp( argv[i], "-s" ) == 0 )
+            is_twoSet = true;
+        else
+        {
+            fprintf( stderr, "usage: %s [-p] [-t p] [-e | -b | -i | -w | -c | -o | -n | -d k | -s]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    unsigned rec_no; // # of rectangle
+
+    if( scanf( "%u", &rec_no ) != 1 )
+        rec_no = 0;
+
+    double total_area, perimeter;
+
+    if( is_integer )
+    {
+        vector<int_rectangle> rec_set; // all rectangles of non-zero area (use no offset)
+        int_rectangle rec;
+        rec_set.reserve( rec_no );
+
+        for( unsigned i=0; i<rec_no; ++i )
+        {
+            if( scanf( "%lld %lld %lld %lld", &rec.left_x, &rec.bottom_y, &rec.right_x, &rec.up_y ) != 4 )
+                break;
+
+            if( rec.up_y == rec.bottom_y || rec.left_x == rec.right_x )
+                continue;
+
+            assert( rec.right_x > rec.left_x && rec.up_y > rec.bottom_y );
+            rec_set.push_back( rec );
+        }
+
+        int_area_arena arena;
+        __int128 exact_perimeter;
+        __int128 exact_area = rec_union_area( rec_set.data(), rec_set.size(), arena, exact_perimeter );
+
+        print_int128( exact_area );
+
+        if( with_perimeter )
+        {
+            putchar( ' ' );
+            print_int128( exact_perimeter );
+        }
+
+        putchar( '\n' );
+
+        return 0;
+    }
+
+    if( is_batch )
+    {
+        unsigned    set_no = rec_no; // the first number is # of sets
+        batch_input batch;
+        rectangle   rec;
+
+        batch.set_begin.push_back( 0 );
+
+        for( unsigned s=0; s<set_no; ++s )
+        {
+            if( scanf( "%u", &rec_no ) != 1 )
+                rec_no = 0;
+
+            for( unsigned i=0; i<rec_no; ++i )
+            {
+                if( scanf( "%lf %lf %lf %lf", &rec.left_x, &rec.bottom_y, &rec.right_x, &rec.up_y ) != 4 )
+                    break;
+
+                if( fabs( rec.up_y-rec.bottom_y ) < PRECISION || fabs( rec.left_x-rec.right_x ) < PRECISION )
+                    continue;
+
+                assert( rec.right_x >= rec.left_x && rec.up_y >= rec.bottom_y );
+                batch.rec_pool.push_back( rec );
+            }
+
+            batch.set_begin.push_back( batch.rec_pool.size() );
+        }
+
+        vector<double> set_area, set_perimeter;
+        batch_area( batch, thread_no, set_area, set_perimeter );
+
+        for( unsigned s=0; s<set_no; ++s )
+        {
+            if( with_perimeter )
+                printf( "%lf %lf\n", set_area[s], set_perimeter[s] );
+            else
+                printf( "%lf\n", set_area[s] );
+        }
+
+        return 0;
+    }
+
+    if( is_external )
+    {
+        total_area = external_area( rec_no, perimeter );
+
+        if( with_perimeter )
+            printf( "%lf %lf\n", total_area, perimeter );
+        else
+            printf( "%lf\n", total_area );
+
+        return 0;
+    }
+
+    if( is_overlap || is_overlapCount )
+    {
+        vector<rectangle> rec_set( rec_no ); // all rectangles, pairs name their positions (use no offset)
+
+        for( unsigned i=0; i<rec_no; ++i )
+        {
+            rectangle &rec = rec_set[i];
+
+            if( scanf( "%lf %lf %lf %lf", &rec.left_x, &rec.bottom_y, &rec.right_x, &rec.up_y ) != 4 )
+            {
+                rec_set.resize( i );
+                break;
+            }
+        }
+
+        overlap_report( rec_set, thread_no, !is_overlapCount );
+
+        return 0;
+    }
+
+    vector<rectangle> rec_set; // all rectangles of non-zero area (use no offset)
+    rec_set.reserve( rec_no );
+
+    { // parse input
+        rectangle rec;
+
+        for( unsigned i=0; i<rec_no; ++i )
+        {
+            if( scanf( "%lf %lf %lf %lf", &rec.left_x, &rec.bottom_y, &rec.right_x, &rec.up_y ) != 4 )
+                break;
+
+            if( fabs( rec.up_y-rec.bottom_y ) < PRECISION || fabs( rec.left_x-rec.right_x ) < PRECISION )
+                continue;
+
+            assert( rec.right_x >= rec.left_x && rec.up_y >= rec.bottom_y );
+            rec_set.push_back( rec );
+        }
+    }
+
+    if( is_contour )
+    {
+        contour_sweep( rec_set );
+        return 0;
+    }
+
+    if( is_twoSet )
+    {
+        unsigned          set_no; // # of rectangles of set B
+        vector<rectangle> set_b;
+
+        if( scanf( "%u", &set_no ) != 1 )
+            set_no = 0;
+
+        for( unsigned i=0; i<set_no; ++i )
+        {
+            rectangle rec;
+
+            if( scanf( "%lf %lf %lf %lf", &rec.left_x, &rec.bottom_y, &rec.right_x, &rec.up_y ) != 4 )
+                break;
+
+            if( fabs( rec.up_y-rec.bottom_y ) < PRECISION || fabs( rec.left_x-rec.right_x ) < PRECISION )
+                continue;
+
+            assert( rec.right_x >= rec.left_x && rec.up_y >= rec.bottom_y );
+            set_b.push_back( rec );
+        }
+
+        double area_a, area_b, area_both, area_union;
+        boolean_area( rec_set, set_b, area_a, area_b, area_both, area_union );
+
+        printf( "%lf %lf %lf %lf %lf\n", area_a, area_b, area_both, area_union,
+                area_union > PRECISION ? area_both/area_union : 0.0 );
+
+        return 0;
+    }
+
+    if( coverage_k > 0 )
+    {
+        vector<double> depth_set;
+        depth_area( rec_set, coverage_k, depth_set );
+
+        for( unsigned depth=1; depth<=coverage_k; ++depth )
+            printf( "%u %lf\n", depth, fabs( depth_set[depth-1] ) > PRECISION ? depth_set[depth-1] : 0.0 );
+
+        return 0;
+    }
+
+    if( is_window )
+    {
+        unsigned query_no; // # of windows
+
+        if( scanf( "%u", &query_no ) != 1 )
+            query_no = 0;
+
+        vector<rectangle> window_set( query_no );
+
+        for( unsigned i=0; i<query_no; ++i )
+        {
+            rectangle &window = window_set[i];
+
+            if( scanf( "%lf %lf %lf %lf", &window.left_x, &window.bottom_y, &window.right_x, &window.up_y ) != 4 )
+            {
+                window_set.resize( i );
+                break;
+            }
+        }
+
+        vector<double> answer;
+        window_area( rec_set, window_set, answer );
+
+        for( unsigned i=0; i<answer.size(); ++i )
+            printf( "%lf\n", fabs( answer[i] ) > PRECISION ? answer[i] : 0.0 );
+
+        return 0;
+    }
+
+    if( raster_area( rec_set, total_area, perimeter ) )
+    {
+        // small integer grid, no sweep needed
+    }
+    else if( thread_no > 0 )
+        total_area = parallel_area( rec_set, thread_no, perimeter );
+    else
+    {
+        area_arena arena;
+        total_area = rec_union_area( rec_set.data(), rec_set.size(), arena, perimeter );
+    }
+
+    if( with_perimeter )
+        printf( "%lf %lf\n", total_area, perimeter );
+    else
+        printf( "%lf\n", total_area );
+
+    return 0;
+}
@@ -0,0 +1,260 @@
+/*************************************************************************************
+
+  Header-only union area and perimeter of iso-oriented rectangles, the library entry
+  point of area_rec.cpp
+
+  rec_union_area( rec_set, rec_no, arena, perimeter ) returns the union area of the
+  rec_no rectangles starting at rec_set and sets their union perimeter
+    arena: interval_set, endpoint_set, scan_line_set, map_to_real and the segment tree
+           of the last call, kept so that the next call on the same arena reuses their
+           memory; one arena per thread, calls on different arenas are independent
+  Coordinates: rectangle/area_arena are the double versions (endpoints closer than
+               PRECISION are merged); int_rectangle/int_area_arena take long long
+               coordinates, merge equal endpoints only, keep integer lengths in the tree
+               and sum area and perimeter in __int128, so their answers are exact as long
+               as the extent of the input (max x - min x, max y - min y) fits long long
+  Time complexity: O(n*logn), where n is # of rectangles
+  Method: segment tree (../segment_tree/segment_tree.h) with perimeter_augment, scan line
+
+ ************************************************************************************/
+
+#ifndef AREA_REC_H
+#define AREA_REC_H
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+#include "../segment_tree/segment_tree.h"
+
+// --------------- class definition --------------- //
+
+template <class coord_type>
+class basic_rectangle
+{
+    public:
+        coord_type left_x, bottom_y, right_x, up_y;
+};
+
+template <class coord_type>
+class scan_line
+{
+    public:
+        coord_type height;      // y-coordinate
+        unsigned   interval_id; // the interval being scanned now, id of interval == id of rectangle
+        bool       is_bottom;   // true if it is bottom of rectange, otherwise it is top
+};
+
+// sum type of areas and perimeters, and the ends of the y-axis for an unbounded slab
+template <class coord_type>
+class area_traits
+{
+    public:
+        typedef double area_type;
+
+        static coord_type low_end(void)  { return -HUGE_VAL; }
+        static coord_type high_end(void) { return HUGE_VAL; }
+};
+
+template <>
+class area_traits<long long>
+{
+    public:
+        typedef __int128 area_type; // one strip adds less than (2^63)^2, the union is below that too
+
+        static long long low_end(void)  { return LLONG_MIN; }
+        static long long high_end(void) { return LLONG_MAX; }
+};
+
+// running area and perimeter of a sweep
+template <class coord_type>
+class basic_sweep_state
+{
+    public:
+        typedef typename area_traits<coord_type>::area_type area_type;
+
+        basic_sweep_state(void) { area = 0; perimeter = 0; last_y = 0; last_length = 0; is_started = false; }
+
+        area_type  area, perimeter;
+        coord_type last_y;      // height of the previous scan line
+        coord_type last_length; // covered length after the previous scan line
+        bool       is_started;
+};
+
+// working memory of a sweep, cleared but not freed between calls
+template <class coord_type>
+class basic_area_arena
+{
+    public:
+        std::vector< interval<coord_type> >  interval_set;  // each rectangle offers an interval (use +1 offset)
+        std::vector< endpoint<coord_type> >  endpoint_set;  // all endpoints (use no offset)
+        std::vector< scan_line<coord_type> > scan_line_set;
+        std::vector<coord_type>              map_to_real;   // mapped space to real value, (use +1 offset)
+        segment_tree<coord_type, perimeter_augment> tree;   // segment tree (use +1 offset)
+};
+
+typedef basic_rectangle<double>    rectangle;
+typedef basic_rectangle<long long> int_rectangle;
+
+typedef basic_sweep_state<double> sweep_state;
+
+typedef basic_area_arena<double>    area_arena;
+typedef basic_area_arena<long long> int_area_arena;
+
+typedef segment_tree<double, perimeter_augment> area_tree;
+
+// --------------- function declaration --------------- //
+
+template <class coord_type>
+bool cmp_small_slHeight( const scan_line<coord_type> &s1, const scan_line<coord_type> &s2 );
+
+template <class coord_type>
+void sweep_event( segment_tree<coord_type, perimeter_augment> &tree, basic_sweep_state<coord_type> &state,
+                  coord_type height, unsigned left_x, unsigned right_x, bool is_bottom, bool count_horizontal );
+
+template <class coord_type>
+typename area_traits<coord_type>::area_type
+sweep_area( const basic_rectangle<coord_type> *rec_set, unsigned rec_no, coord_type low_y, coord_type high_y,
+            basic_area_arena<coord_type> &arena, typename area_traits<coord_type>::area_type &perimeter );
+
+template <class coord_type>
+typename area_traits<coord_type>::area_type
+rec_union_area( const basic_rectangle<coord_type> *rec_set, unsigned rec_no, basic_area_arena<coord_type> &arena,
+                typename area_traits<coord_type>::area_type &perimeter );
+
+// --------------- function definition --------------- //
+
+// strict weak order for std::sort, tie break is bottom of rectangle first
+template <class coord_type>
+inline bool cmp_small_slHeight( const scan_line<coord_type> &s1, const scan_line<coord_type> &s2 )
+{
+    if( s1.height != s2.height )
+        return ( s1.height < s2.height );
+    else
+        return ( s1.is_bottom && !(s2.is_bottom) );
+}
+
+// apply one scan line: the strip since the previous scan line adds its area and two vertical
+// edges per covered run, the change of the covered length adds horizontal edges
+template <class coord_type>
+inline void sweep_event( segment_tree<coord_type, perimeter_augment> &tree, basic_sweep_state<coord_type> &state,
+                         coord_type height, unsigned left_x, unsigned right_x, bool is_bottom, bool count_horizontal )
+{
+    typedef typename area_traits<coord_type>::area_type area_type;
+
+    if( !state.is_started )
+    {
+        state.last_y = height;
+        state.is_started = true;
+    }
+
+    coord_type length_y = height - state.last_y;
+    assert( length_y >= 0 );
+    state.area      += (static_cast<area_type>(length_y) * state.last_length);
+    state.perimeter += (static_cast<area_type>(length_y) * 2 * covered_segment( tree, 1 ));
+
+    if( is_bottom )
+        interval_insertion( left_x, right_x, tree );
+    else
+        interval_deletion( left_x, right_x, tree );
+
+    coord_type length = covered_length( tree, 1 );
+
+    if( count_horizontal )
+        state.perimeter += ( length > state.last_length ) ? length-state.last_length : state.last_length-length;
+
+    state.last_y = height;
+    state.last_length = length;
+}
+
+// union area and perimeter of the rectangles clipped to the slab low_y <= y <= high_y
+// the horizontal edges on low_y are left to the slab below, unless low_y is the low end of the axis
+template <class coord_type>
+inline typename area_traits<coord_type>::area_type
+sweep_area( const basic_rectangle<coord_type> *rec_set, unsigned rec_no, coord_type low_y, coord_type high_y,
+            basic_area_arena<coord_type> &arena, typename area_traits<coord_type>::area_type &perimeter )
+{
+    std::vector< interval<coord_type> >  &interval_set  = arena.interval_set;
+    std::vector< endpoint<coord_type> >  &endpoint_set  = arena.endpoint_set;
+    std::vector< scan_line<coord_type> > &scan_line_set = arena.scan_line_set;
+
+    interval_set.resize( 1 );
+    endpoint_set.clear();
+    scan_line_set.clear();
+
+    for( unsigned i=0; i<rec_no; ++i )
+    {
+        const basic_rectangle<coord_type> &rec = rec_set[i];
+
+        if( !(rec.bottom_y <= high_y && rec.up_y > low_y) )
+            continue;
+
+        unsigned id = interval_set.size();
+        interval_set.push_back( interval<coord_type>() );
+        interval_set[id].rLeft_x  = rec.left_x;
+        interval_set[id].rRight_x = rec.right_x;
+        interval_set[id].rLength  = rec.right_x - rec.left_x;
+
+        endpoint_set.push_back( endpoint<coord_type>() );
+        endpoint_set.back().init( rec.left_x, id, true );
+        endpoint_set.push_back( endpoint<coord_type>() );
+        endpoint_set.back().init( rec.right_x, id, false );
+
+        scan_line<coord_type> line;
+        line.interval_id = id;
+        line.height      = std::max( rec.bottom_y, low_y );
+        line.is_bottom   = true;
+        scan_line_set.push_back( line );
+
+        if( rec.up_y <= high_y ) // a rectangle crossing high_y is still open at the end
+        {
+            line.height    = rec.up_y;
+            line.is_bottom = false;
+            scan_line_set.push_back( line );
+        }
+    }
+
+    perimeter = 0;
+
+    if( scan_line_set.empty() )
+        return 0;
+
+    // map the real space to integer space counting from integer 1
+    unsigned global_max_x = compress_endpoints( endpoint_set, interval_set, arena.map_to_real ); // max x of the mapped space, min x is 1
+
+    segment_tree<coord_type, perimeter_augment> &tree = arena.tree;
+    tree_construct( tree, arena.map_to_real, global_max_x );
+
+    // sort height of scan lines in ascending order, bottom interval first if tie
+    std::sort( scan_line_set.begin(), scan_line_set.end(), cmp_small_slHeight<coord_type> );
+
+    basic_sweep_state<coord_type> state;
+    bool is_inner_low = ( low_y > area_traits<coord_type>::low_end() );
+
+    // every rectangle owns its two scan lines, so the bottom is always met before the top
+    for( unsigned i=0; i<scan_line_set.size(); ++i )
+    {
+        const scan_line<coord_type> &target_line = scan_line_set[i];
+        const interval<coord_type> &target = interval_set[target_line.interval_id];
+
+        sweep_event( tree, state, target_line.height, target.left_x, target.right_x, target_line.is_bottom,
+                     !(is_inner_low && target_line.height == low_y) );
+    }
+
+    perimeter = state.perimeter;
+
+    return state.area;
+}
+
+template <class coord_type>
+inline typename area_traits<coord_type>::area_type
+rec_union_area( const basic_rectangle<coord_type> *rec_set, unsigned rec_no, basic_area_arena<coord_type> &arena,
+                typename area_traits<coord_type>::area_type &perimeter )
+{
+    return sweep_area( rec_set, rec_no, area_traits<coord_type>::low_end(), area_traits<coord_type>::high_end(), arena,
+                       perimeter );
+}
+
+#endif
@@ -0,0 +1,88 @@
+/*************************************************************************************
+
+   Input: stream of commands "I l b r u" (insert the rectangle [l, r]x[b, u]) or
+          "D l b r u" (delete it), no rectangle has to be known in advance
+   Output: area of union of the current set of rectangles after each command
+   Time complexity: query O(1), the total is kept up to date by every update
+      Update -> O(k*logn+B*logn) for the k slabs the rectangle reaches, B=sqrt(n);
+         k is O(sqrt(n)) as there are O(n/B) slabs, so even a rectangle spanning the
+         whole set is sublinear, and O(1) slabs for small ones as in layout edits
+      Split of a slab -> O(t+B*logn) for the t nodes of its tree, amortized over the
+         B updates that filled it
+      Rebuild when n doubled or halved since the last one -> O(n*logn+s*logn) for s
+         (rectangle, spanned slab) pairs, amortized over the n/2 updates before it
+   Method: sqrt-decomposition of the y-axis into slabs
+      Every slab lists the rectangles with a horizontal edge inside it (partial
+      rectangles, about B of them) and keeps a profile tree, a treap over the x
+      endpoints of all rectangles reaching it: the spanning rectangles add +1/-1
+      coverage at their endpoints, and every x-segment between two endpoints stores
+      the height of the slab covered there by the partial rectangles; each node
+      sums the least coverage of its segments with their length and their profile
+      area, so the covered area of the slab is read at the root: the full height
+      where some spanning rectangle covers x, the profile elsewhere
+      An update adds (or removes) a spanning rectangle with two endpoint updates;
+      for a partial one it recomputes the profile under its x-range by a scan line
+      sweep of the partial rectangles meeting that range, assigned lazily to the
+      range in O(logn); the total is the sum of the slab areas, refreshed at every
+      slab the rectangle reaches
+      A slab holding more than 2B partial rectangles is split at the median height
+      of their edges, each half sorts the old partial rectangles into spanning or
+      partial ones and recomputes its profile
+
+ ************************************************************************************/
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "online_area_rec.h"
+
+#define NDEBUG
+
+// --------------- function declaration --------------- //
+
+void report_result( const online_area &structure );
+
+using std::vector;
+
+// --------------- function definition --------------- //
+
+void report_result( const online_area &structure )
+{
+    if( fabs(structure.total_area) > PRECISION )
+        printf( "%lf\n", structure.total_area );
+    else
+        printf( "0.000000\n" );
+}
+
+// --------------- main function --------------- //
+
+int main( int argc, char **argv )
+{
+    // freopen( "../rectangle_cases/stream1.in", "r", stdin );
+
+    online_area structure;
+    online_rect rec;
+    char        instruction[4]; // 'D' or 'I'
+
+    while( scanf( "%3s %lf %lf %lf %lf", instruction, &rec.left_x, &rec.bottom_y, &rec.right_x, &rec.up_y ) == 5 )
+    {
+        if( instruction[0] == 'I' )
+            rect_insertion( structure, rec );
+        else
+        {
+            assert( instruction[0] == 'D' );
+
+            if( !rect_deletion( structure, rec ) )
+            {
+                printf( "[%lf, %lf]x[%lf, %lf] not inserted yet\n", rec.left_x, rec.right_x, rec.bottom_y, rec.up_y );
+                continue;
+            }
+        }
+
+        report_result( structure );
+    }
+
+    return 0;
+}
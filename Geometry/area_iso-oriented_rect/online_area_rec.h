@@ -0,0 +1,790 @@
+/*************************************************************************************
+
+  Header-only online union area of iso-oriented rectangles, the structure behind
+  online_area_rec.cpp
+
+  rect_insertion( structure, rec ) and rect_deletion( structure, rec ) add or remove
+  the rectangle [rec.left_x, rec.right_x]x[rec.bottom_y, rec.up_y], a deletion names
+  the rectangle by its coordinates and returns false if none such is inserted;
+  structure.total_area is the union area of the rectangles inserted and not deleted
+  Time complexity: see online_area_rec.cpp, O(k*logn+B*logn) per update for a
+                   rectangle reaching k slabs, B=sqrt(n)
+  Method: sqrt-decomposition of the y-axis into slabs, every slab keeps a profile
+          tree over x: the rectangles spanning the slab are counted as x-intervals
+          and every x-segment also carries the height covered there by the partial
+          rectangles of the slab, so the covered area of the slab is read at the root
+
+ ************************************************************************************/
+
+#ifndef ONLINE_AREA_REC_H
+#define ONLINE_AREA_REC_H
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "../segment_tree/dynamic_segment_tree.h"
+
+#ifndef PRECISION
+#define PRECISION 0.000001
+#endif
+
+#ifndef MIN_SLAB_SIZE
+#define MIN_SLAB_SIZE 16 // smallest B, slabs of fewer edges are not worth their trees
+#endif
+
+// --------------- class definition --------------- //
+
+class online_rect
+{
+    public:
+        double left_x, bottom_y, right_x, up_y;
+        bool   is_live;
+};
+
+// aggregate of a run of consecutive endpoints low_x = x_1 < ... < x_k = high_x of a profile tree
+// (k=0 if empty) over the k-1 segments between them; the coverage of [x_j, x_j+1) by spanning
+// rectangles is the delta sum of x_1..x_j and its partial height is the profile of x_j
+class profile_summary
+{
+    public:
+        profile_summary(void)
+        {
+            endpoint_no = 0; delta_sum = 0; min_cover = INT_MAX; min_length = 0.0; min_weight = 0.0;
+            last_profile = 0.0; low_x = 0.0; high_x = 0.0;
+        }
+
+        unsigned endpoint_no;
+        int      delta_sum;
+        int      min_cover;    // least coverage of the segments, INT_MAX if there are none
+        double   min_length;   // length of the segments at min_cover
+        double   min_weight;   // their area under the profile
+        double   last_profile; // profile of x_k, it holds on the segment right of the run
+        double   low_x, high_x;
+};
+
+// endpoint of a spanning rectangle or of a partial one (delta 0), one node per distinct x
+class profile_node
+{
+    public:
+        profile_node(void) { leftChild_id = 0; rightChild_id = 0; priority = 0; x = 0.0; profile = 0.0; delta = 0; ref_count = 0; has_tag = false; tag = 0.0; }
+
+        unsigned leftChild_id, rightChild_id; // 0 if none
+        unsigned priority;  // heap order of the treap, larger on top
+        double   x;
+        double   profile;   // height covered by the partial rectangles on [x, next x)
+        int      delta;     // # of spanning rectangles starting at x minus # ending at x
+        unsigned ref_count; // # of rectangle endpoints at x, the node is released at 0
+        bool     has_tag;   // the profile of the whole subtree is tag, children not told yet
+        double   tag;
+        profile_summary subtree;
+};
+
+// treap of profile nodes, node 0 is the null node
+class profile_tree
+{
+    public:
+        profile_tree(void) { pool.resize(1); root_id = 0; seed = 2463534242u; }
+
+        std::vector<profile_node> pool;
+        std::vector<unsigned>     free_id; // recycled node ids
+        unsigned                  root_id;
+        unsigned                  seed;    // xorshift state of the priorities
+};
+
+// part of the y-axis, slab i spans [low_y, high_y] and slab i+1 starts at high_y
+class slab
+{
+    public:
+        slab(void) { low_y = 0.0; high_y = 0.0; area = 0.0; }
+
+        double       low_y, high_y;
+        profile_tree tree;    // spanning rectangles and profile of the partial ones
+        std::vector<unsigned> partial; // rectangles with a horizontal edge inside (low_y, high_y)
+        double       area;    // covered area inside the slab
+};
+
+// x-event of the partial rectangles while a profile is computed
+class profile_event
+{
+    public:
+        double   x;
+        double   bottom_y, up_y; // clipped to the slab
+        bool     is_left;
+};
+
+typedef std::pair< std::pair<double, double>, std::pair<double, double> > rect_key;
+
+class online_area
+{
+    public:
+        online_area(void) { total_area = 0.0; live_no = 0; rebuild_no = 0; slab_size = MIN_SLAB_SIZE; }
+
+        std::vector<online_rect> rec_set;   // (use no offset)
+        std::vector<unsigned>    free_id;   // recycled rectangle ids
+        std::map< rect_key, std::vector<unsigned> > live_id; // live rectangles by coordinates
+
+        std::vector<slab>          slab_set;  // ascending in y, covers (-infinity, infinity)
+        std::vector<profile_event> event_set; // scratch of slab_profile
+        dynamic_tree               cover_y;   // scratch of slab_profile, y-intervals of the partial rectangles
+
+        double   total_area;
+        unsigned live_no;    // # of live rectangles of non-zero area
+        unsigned rebuild_no; // live_no at the last rebuild
+        unsigned slab_size;  // B
+};
+
+// --------------- function declaration --------------- //
+
+profile_summary profile_merge( const profile_summary &left, const profile_summary &right );
+
+profile_summary profile_single( const profile_node &cur );
+
+void profile_apply( profile_tree &tree, unsigned cur_id, double profile );
+
+void profile_push( profile_tree &tree, unsigned cur_id );
+
+void profile_pull( profile_tree &tree, unsigned cur_id );
+
+unsigned profile_new( profile_tree &tree, double x, double profile );
+
+unsigned profile_remove( profile_tree &tree, unsigned cur_id );
+
+unsigned profile_update( profile_tree &tree, unsigned cur_id, double x, int delta, bool is_insertion, double left_profile );
+
+void profile_assign( profile_tree &tree, unsigned cur_id, double low_x, double high_x, double profile );
+
+double profile_area( const profile_tree &tree, double height );
+
+bool cmp_small_peX( const profile_event &e1, const profile_event &e2 );
+
+void slab_profile( online_area &structure, unsigned slab_id, double low_x, double high_x );
+
+void slab_attach( online_area &structure, unsigned slab_id, unsigned rect_id, bool is_insertion );
+
+void slab_measure( online_area &structure, unsigned slab_id );
+
+void slab_split( online_area &structure, unsigned slab_id );
+
+void structure_rebuild( online_area &structure );
+
+void rect_update( online_area &structure, unsigned rect_id, bool is_insertion );
+
+void rect_insertion( online_area &structure, const online_rect &rec );
+
+bool rect_deletion( online_area &structure, const online_rect &rec );
+
+// --------------- function definition --------------- //
+
+// summary of the endpoints of left followed by those of right, all of left lie below right
+inline profile_summary profile_merge( const profile_summary &left, const profile_summary &right )
+{
+    if( left.endpoint_no == 0 )
+        return right;
+
+    if( right.endpoint_no == 0 )
+        return left;
+
+    profile_summary merged;
+    merged.endpoint_no  = left.endpoint_no + right.endpoint_no;
+    merged.delta_sum    = left.delta_sum + right.delta_sum;
+    merged.last_profile = right.last_profile;
+    merged.low_x        = left.low_x;
+    merged.high_x       = right.high_x;
+
+    // the segments of left, the gap [left.high_x, right.low_x) and the segments of right
+    double gap = right.low_x - left.high_x;
+    int    cover[3]  = { left.min_cover, left.delta_sum, (right.min_cover == INT_MAX) ? INT_MAX : left.delta_sum + right.min_cover };
+    double length[3] = { left.min_length, gap, right.min_length };
+    double weight[3] = { left.min_weight, gap*left.last_profile, right.min_weight };
+
+    merged.min_cover  = std::min( cover[0], std::min( cover[1], cover[2] ) );
+    merged.min_length = 0.0;
+    merged.min_weight = 0.0;
+
+    for( unsigned i=0; i<3; ++i )
+    {
+        if( cover[i] == merged.min_cover )
+        {
+            merged.min_length += length[i];
+            merged.min_weight += weight[i];
+        }
+    }
+
+    return merged;
+}
+
+inline profile_summary profile_single( const profile_node &cur )
+{
+    profile_summary single;
+    single.endpoint_no  = 1;
+    single.delta_sum    = cur.delta;
+    single.last_profile = cur.profile;
+    single.low_x        = cur.x;
+    single.high_x       = cur.x;
+
+    return single;
+}
+
+// every node of the subtree gets the profile, its children are told on the next visit
+inline void profile_apply( profile_tree &tree, unsigned cur_id, double profile )
+{
+    if( cur_id == 0 )
+        return;
+
+    profile_node &cur = tree.pool[cur_id];
+    cur.profile = profile;
+    cur.has_tag = true;
+    cur.tag     = profile;
+    cur.subtree.min_weight   = cur.subtree.min_length * profile;
+    cur.subtree.last_profile = profile;
+}
+
+inline void profile_push( profile_tree &tree, unsigned cur_id )
+{
+    profile_node &cur = tree.pool[cur_id];
+
+    if( !cur.has_tag )
+        return;
+
+    cur.has_tag = false;
+    profile_apply( tree, cur.leftChild_id, cur.tag );
+    profile_apply( tree, cur.rightChild_id, cur.tag );
+}
+
+// recompute the summary of the node from its children
+inline void profile_pull( profile_tree &tree, unsigned cur_id )
+{
+    profile_node &cur = tree.pool[cur_id];
+
+    cur.subtree = profile_merge( profile_merge( tree.pool[cur.leftChild_id].subtree, profile_single( cur ) ),
+                                 tree.pool[cur.rightChild_id].subtree );
+}
+
+inline unsigned profile_new( profile_tree &tree, double x, double profile )
+{
+    unsigned cur_id;
+
+    if( !tree.free_id.empty() )
+    {
+        cur_id = tree.free_id.back();
+        tree.free_id.pop_back();
+        tree.pool[cur_id] = profile_node();
+    }
+    else
+    {
+        tree.pool.push_back( profile_node() );
+        cur_id = tree.pool.size()-1;
+    }
+
+    tree.seed ^= tree.seed << 13;
+    tree.seed ^= tree.seed >> 17;
+    tree.seed ^= tree.seed << 5;
+
+    tree.pool[cur_id].priority = tree.seed;
+    tree.pool[cur_id].x        = x;
+    tree.pool[cur_id].profile  = profile;
+
+    return cur_id;
+}
+
+// rotate the node down until it has at most one child, then splice it out; returns the id of
+// the node taking its place, the segment of the node joins the one on its left
+inline unsigned profile_remove( profile_tree &tree, unsigned cur_id )
+{
+    profile_push( tree, cur_id );
+
+    profile_node &cur = tree.pool[cur_id]; // the pool does not grow during removal
+    unsigned left_id = cur.leftChild_id, right_id = cur.rightChild_id;
+
+    if( left_id == 0 || right_id == 0 )
+    {
+        tree.free_id.push_back( cur_id );
+        return left_id + right_id;
+    }
+
+    if( tree.pool[left_id].priority > tree.pool[right_id].priority ) // rotate right
+    {
+        profile_push( tree, left_id );
+        cur.leftChild_id = tree.pool[left_id].rightChild_id;
+        tree.pool[left_id].rightChild_id = profile_remove( tree, cur_id );
+        profile_pull( tree, left_id );
+
+        return left_id;
+    }
+    else
+    {
+        profile_push( tree, right_id );
+        cur.rightChild_id = tree.pool[right_id].leftChild_id;
+        tree.pool[right_id].leftChild_id = profile_remove( tree, cur_id );
+        profile_pull( tree, right_id );
+
+        return right_id;
+    }
+}
+
+// add delta at endpoint x below the node, creating (is_insertion) or releasing the node of x;
+// a new node splits the segment it falls in and keeps its profile, left_profile is the profile
+// of the last node left of the subtree; returns the id of the node taking the place of cur_id
+inline unsigned profile_update( profile_tree &tree, unsigned cur_id, double x, int delta, bool is_insertion, double left_profile )
+{
+    if( cur_id == 0 )
+    {
+        assert( is_insertion );
+        cur_id = profile_new( tree, x, left_profile );
+        tree.pool[cur_id].delta     = delta;
+        tree.pool[cur_id].ref_count = 1;
+        profile_pull( tree, cur_id );
+
+        return cur_id;
+    }
+
+    profile_push( tree, cur_id );
+
+    if( x < tree.pool[cur_id].x )
+    {
+        unsigned child_id = profile_update( tree, tree.pool[cur_id].leftChild_id, x, delta, is_insertion, left_profile ); // may move the pool
+        profile_node &cur = tree.pool[cur_id];
+        cur.leftChild_id = child_id;
+
+        if( child_id != 0 && tree.pool[child_id].priority > cur.priority ) // rotate right
+        {
+            cur.leftChild_id = tree.pool[child_id].rightChild_id;
+            tree.pool[child_id].rightChild_id = cur_id;
+            profile_pull( tree, cur_id );
+            profile_pull( tree, child_id );
+
+            return child_id;
+        }
+    }
+    else if( x > tree.pool[cur_id].x )
+    {
+        unsigned child_id = profile_update( tree, tree.pool[cur_id].rightChild_id, x, delta, is_insertion, tree.pool[cur_id].profile );
+        profile_node &cur = tree.pool[cur_id];
+        cur.rightChild_id = child_id;
+
+        if( child_id != 0 && tree.pool[child_id].priority > cur.priority ) // rotate left
+        {
+            cur.rightChild_id = tree.pool[child_id].leftChild_id;
+            tree.pool[child_id].leftChild_id = cur_id;
+            profile_pull( tree, cur_id );
+            profile_pull( tree, child_id );
+
+            return child_id;
+        }
+    }
+    else
+    {
+        profile_node &cur = tree.pool[cur_id];
+        cur.delta += delta;
+
+        if( is_insertion )
+            (cur.ref_count)++;
+        else if( --(cur.ref_count) == 0 )
+        {
+            assert( cur.delta == 0 );
+            return profile_remove( tree, cur_id );
+        }
+    }
+
+    profile_pull( tree, cur_id );
+
+    return cur_id;
+}
+
+// the nodes with low_x <= x < high_x below the node get the profile, O(logn)
+inline void profile_assign( profile_tree &tree, unsigned cur_id, double low_x, double high_x, double profile )
+{
+    if( cur_id == 0 )
+        return;
+
+    const profile_summary &subtree = tree.pool[cur_id].subtree;
+
+    if( subtree.high_x < low_x || subtree.low_x >= high_x )
+        return;
+
+    if( low_x <= subtree.low_x && subtree.high_x < high_x )
+    {
+        profile_apply( tree, cur_id, profile );
+        return;
+    }
+
+    profile_push( tree, cur_id );
+
+    profile_node &cur = tree.pool[cur_id];
+
+    if( low_x <= cur.x && cur.x < high_x )
+        cur.profile = profile;
+
+    profile_assign( tree, cur.leftChild_id, low_x, high_x, profile );
+    profile_assign( tree, cur.rightChild_id, low_x, high_x, profile );
+    profile_pull( tree, cur_id );
+}
+
+// covered area of a slab of the given height: full height where a spanning rectangle covers x,
+// the profile elsewhere
+inline double profile_area( const profile_tree &tree, double height )
+{
+    const profile_summary &summary = tree.pool[tree.root_id].subtree;
+
+    if( summary.endpoint_no < 2 )
+        return 0.0;
+
+    if( summary.min_cover > 0 ) // min_cover is never negative
+        return (summary.high_x - summary.low_x) * height;
+
+    double spanned = (summary.high_x - summary.low_x) - summary.min_length;
+
+    // an unbounded slab has no spanning rectangles
+    return ( spanned > 0.0 && height < HUGE_VAL ) ? spanned*height + summary.min_weight : summary.min_weight;
+}
+
+// strict weak order for std::sort, tie break is left edge first
+inline bool cmp_small_peX( const profile_event &e1, const profile_event &e2 )
+{
+    if( e1.x != e2.x )
+        return ( e1.x < e2.x );
+    else
+        return ( e1.is_left && !(e2.is_left) );
+}
+
+// recompute the profile of the slab on [low_x, high_x) by a sweep in x over the partial
+// rectangles meeting it, their y-intervals clipped to the slab -> O(m*logn) for m of them
+inline void slab_profile( online_area &structure, unsigned slab_id, double low_x, double high_x )
+{
+    slab                       &target = structure.slab_set[slab_id];
+    std::vector<profile_event> &event_set = structure.event_set;
+
+    event_set.clear();
+
+    for( unsigned i=0; i<target.partial.size(); ++i )
+    {
+        const online_rect &rec = structure.rec_set[target.partial[i]];
+
+        if( rec.right_x <= low_x || rec.left_x >= high_x )
+            continue;
+
+        profile_event event;
+        event.bottom_y = std::max( rec.bottom_y, target.low_y );
+        event.up_y     = std::min( rec.up_y, target.high_y );
+        event.x        = std::max( rec.left_x, low_x );
+        event.is_left  = true;
+        event_set.push_back( event );
+        event.x        = std::min( rec.right_x, high_x );
+        event.is_left  = false;
+        event_set.push_back( event );
+    }
+
+    std::sort( event_set.begin(), event_set.end(), cmp_small_peX );
+
+    double last_x = low_x;
+
+    for( unsigned i=0; ; )
+    {
+        for( ; i<event_set.size() && event_set[i].x == last_x; ++i )
+        {
+            if( event_set[i].is_left )
+                interval_insertion( event_set[i].bottom_y, event_set[i].up_y, structure.cover_y );
+            else
+                interval_deletion( event_set[i].bottom_y, event_set[i].up_y, structure.cover_y );
+        }
+
+        double next_x = ( i < event_set.size() ) ? event_set[i].x : high_x;
+
+        profile_assign( target.tree, target.tree.root_id, last_x, next_x, covered_length( structure.cover_y ) );
+
+        if( next_x >= high_x )
+            break;
+
+        last_x = next_x;
+    }
+
+    for( ; !event_set.empty() && event_set.back().x >= high_x; event_set.pop_back() ) // ends at high_x
+        interval_deletion( event_set.back().bottom_y, event_set.back().up_y, structure.cover_y );
+}
+
+// add (or remove) the rectangle to a slab it reaches, the caller refreshes the area of the slab
+inline void slab_attach( online_area &structure, unsigned slab_id, unsigned rect_id, bool is_insertion )
+{
+    slab              &target = structure.slab_set[slab_id];
+    const online_rect &rec = structure.rec_set[rect_id];
+    profile_tree      &tree = target.tree;
+
+    if( rec.bottom_y <= target.low_y && rec.up_y >= target.high_y )
+    {
+        int sign = is_insertion ? 1 : -1;
+        tree.root_id = profile_update( tree, tree.root_id, rec.left_x, sign, is_insertion, 0.0 );
+        tree.root_id = profile_update( tree, tree.root_id, rec.right_x, -sign, is_insertion, 0.0 );
+        return;
+    }
+
+    if( is_insertion )
+        target.partial.push_back( rect_id );
+    else
+    {
+        std::vector<unsigned>::iterator it = std::find( target.partial.begin(), target.partial.end(), rect_id );
+        assert( it != target.partial.end() );
+        *it = target.partial.back();
+        target.partial.pop_back();
+    }
+
+    tree.root_id = profile_update( tree, tree.root_id, rec.left_x, 0, is_insertion, 0.0 );
+    tree.root_id = profile_update( tree, tree.root_id, rec.right_x, 0, is_insertion, 0.0 );
+    slab_profile( structure, slab_id, rec.left_x, rec.right_x );
+}
+
+// refresh the area of the slab and the total
+inline void slab_measure( online_area &structure, unsigned slab_id )
+{
+    slab &target = structure.slab_set[slab_id];
+    double area = profile_area( target.tree, target.high_y - target.low_y );
+
+    structure.total_area += area - target.area;
+    target.area = area;
+}
+
+// split at the median edge height inside the slab, the upper half starts from a copy of the
+// tree; a partial rectangle of the slab stays partial in a half, spans it or misses it
+inline void slab_split( online_area &structure, unsigned slab_id )
+{
+    std::vector<double> height;
+
+    {
+        const slab &target = structure.slab_set[slab_id];
+
+        for( unsigned i=0; i<target.partial.size(); ++i )
+        {
+            const online_rect &rec = structure.rec_set[target.partial[i]];
+
+            if( rec.bottom_y > target.low_y )
+                height.push_back( rec.bottom_y );
+
+            if( rec.up_y < target.high_y )
+                height.push_back( rec.up_y );
+        }
+    }
+
+    std::vector<double>::iterator nth = height.begin() + height.size()/2;
+    std::nth_element( height.begin(), nth, height.end() );
+    double split_y = *nth; // inside (low_y, high_y)
+
+    structure.slab_set.insert( structure.slab_set.begin()+slab_id+1, slab() );
+
+    slab &lower = structure.slab_set[slab_id], &upper = structure.slab_set[slab_id+1];
+    std::vector<unsigned> partial;
+    partial.swap( lower.partial );
+
+    upper.low_y  = split_y;
+    upper.high_y = lower.high_y;
+    upper.tree   = lower.tree;
+    upper.area   = 0.0;
+    lower.high_y = split_y;
+
+    for( unsigned h=0; h<2; ++h )
+    {
+        slab         &half = structure.slab_set[slab_id+h];
+        profile_tree &tree = half.tree;
+
+        for( unsigned i=0; i<partial.size(); ++i )
+        {
+            const online_rect &rec = structure.rec_set[partial[i]];
+
+            if( rec.bottom_y < half.high_y && rec.up_y > half.low_y && !(rec.bottom_y <= half.low_y && rec.up_y >= half.high_y) )
+            {
+                half.partial.push_back( partial[i] );
+                continue;
+            }
+
+            tree.root_id = profile_update( tree, tree.root_id, rec.left_x, 0, false, 0.0 );
+            tree.root_id = profile_update( tree, tree.root_id, rec.right_x, 0, false, 0.0 );
+
+            if( rec.bottom_y < half.high_y && rec.up_y > half.low_y ) // spans the half
+            {
+                tree.root_id = profile_update( tree, tree.root_id, rec.left_x, 1, true, 0.0 );
+                tree.root_id = profile_update( tree, tree.root_id, rec.right_x, -1, true, 0.0 );
+            }
+        }
+
+        slab_profile( structure, slab_id+h, -HUGE_VAL, HUGE_VAL );
+    }
+
+    slab_measure( structure, slab_id );
+    slab_measure( structure, slab_id+1 );
+}
+
+// slab boundaries every B-th edge height, B=sqrt(n), every slab built from the live rectangles
+inline void structure_rebuild( online_area &structure )
+{
+    std::vector<double> height;
+
+    for( unsigned i=0; i<structure.rec_set.size(); ++i )
+    {
+        const online_rect &rec = structure.rec_set[i];
+
+        if( rec.is_live )
+        {
+            height.push_back( rec.bottom_y );
+            height.push_back( rec.up_y );
+        }
+    }
+
+    std::sort( height.begin(), height.end() );
+
+    structure.slab_size  = std::max( MIN_SLAB_SIZE, static_cast<int>(sqrt( static_cast<double>(structure.live_no) )) );
+    structure.rebuild_no = structure.live_no;
+    structure.total_area = 0.0;
+    structure.slab_set.clear();
+
+    std::vector<double> bound( 1, -HUGE_VAL );
+
+    for( unsigned i=structure.slab_size; i<height.size(); i+=structure.slab_size )
+    {
+        if( height[i] > bound.back() )
+            bound.push_back( height[i] );
+    }
+
+    bound.push_back( HUGE_VAL );
+    structure.slab_set.resize( bound.size()-1 );
+
+    for( unsigned s=0; s+1<bound.size(); ++s )
+    {
+        structure.slab_set[s].low_y  = bound[s];
+        structure.slab_set[s].high_y = bound[s+1];
+    }
+
+    for( unsigned i=0; i<structure.rec_set.size(); ++i )
+    {
+        const online_rect &rec = structure.rec_set[i];
+
+        if( !rec.is_live )
+            continue;
+
+        // the slabs overlapping (bottom_y, up_y): first one ending above bottom_y up to the one starting at up_y
+        unsigned s = std::upper_bound( bound.begin()+1, bound.end(), rec.bottom_y ) - (bound.begin()+1);
+
+        for( ; s<structure.slab_set.size() && structure.slab_set[s].low_y < rec.up_y; ++s )
+        {
+            slab         &target = structure.slab_set[s];
+            profile_tree &tree   = target.tree;
+            bool is_spanning = ( rec.bottom_y <= target.low_y && rec.up_y >= target.high_y );
+
+            if( !is_spanning )
+                target.partial.push_back( i );
+
+            tree.root_id = profile_update( tree, tree.root_id, rec.left_x, is_spanning ? 1 : 0, true, 0.0 );
+            tree.root_id = profile_update( tree, tree.root_id, rec.right_x, is_spanning ? -1 : 0, true, 0.0 );
+        }
+    }
+
+    for( unsigned s=0; s<structure.slab_set.size(); ++s )
+    {
+        slab_profile( structure, s, -HUGE_VAL, HUGE_VAL );
+        slab_measure( structure, s );
+    }
+}
+
+// add (or remove) the rectangle in every slab it reaches, split the slabs grown too big
+inline void rect_update( online_area &structure, unsigned rect_id, bool is_insertion )
+{
+    const online_rect &rec = structure.rec_set[rect_id];
+    std::vector<slab> &slab_set = structure.slab_set;
+
+    unsigned low = 0, high = slab_set.size(); // first slab with high_y > bottom_y
+
+    while( low < high )
+    {
+        unsigned mid = (low+high)/2;
+
+        if( slab_set[mid].high_y > rec.bottom_y )
+            high = mid;
+        else
+            low = mid+1;
+    }
+
+    unsigned first = low, last = low;
+
+    for( ; last<slab_set.size() && slab_set[last].low_y < rec.up_y; ++last )
+    {
+        slab_attach( structure, last, rect_id, is_insertion );
+        slab_measure( structure, last );
+    }
+
+    if( !is_insertion )
+        return;
+
+    // from the top, so that a split does not move the slabs still to check
+    for( unsigned s=last; s-- > first; )
+    {
+        if( slab_set[s].partial.size() > 2*structure.slab_size )
+            slab_split( structure, s );
+    }
+}
+
+inline void rect_insertion( online_area &structure, const online_rect &rec )
+{
+    unsigned rect_id;
+
+    if( !structure.free_id.empty() )
+    {
+        rect_id = structure.free_id.back();
+        structure.free_id.pop_back();
+    }
+    else
+    {
+        rect_id = structure.rec_set.size();
+        structure.rec_set.push_back( online_rect() );
+    }
+
+    online_rect &target = structure.rec_set[rect_id];
+    target = rec;
+    target.is_live   = !( rec.up_y-rec.bottom_y < PRECISION || rec.right_x-rec.left_x < PRECISION );
+
+    rect_key key( std::make_pair( rec.left_x, rec.bottom_y ), std::make_pair( rec.right_x, rec.up_y ) );
+    structure.live_id[key].push_back( rect_id );
+
+    if( !target.is_live ) // zero area, only remembered for its deletion
+        return;
+
+    structure.live_no++;
+
+    if( structure.live_no > 2*structure.rebuild_no || structure.slab_set.empty() )
+        structure_rebuild( structure );
+    else
+        rect_update( structure, rect_id, true );
+}
+
+// false if no such rectangle is inserted
+inline bool rect_deletion( online_area &structure, const online_rect &rec )
+{
+    rect_key key( std::make_pair( rec.left_x, rec.bottom_y ), std::make_pair( rec.right_x, rec.up_y ) );
+    std::map< rect_key, std::vector<unsigned> >::iterator it = structure.live_id.find( key );
+
+    if( it == structure.live_id.end() )
+        return false;
+
+    unsigned rect_id = it->second.back();
+    it->second.pop_back();
+
+    if( it->second.empty() )
+        structure.live_id.erase( it );
+
+    structure.free_id.push_back( rect_id );
+
+    if( !structure.rec_set[rect_id].is_live )
+        return true;
+
+    rect_update( structure, rect_id, false );
+    structure.rec_set[rect_id].is_live = false;
+    structure.live_no--;
+
+    if( 2*structure.live_no < structure.rebuild_no )
+        structure_rebuild( structure );
+
+    return true;
+}
+
+#endif
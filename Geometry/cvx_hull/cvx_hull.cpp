@@ -4,14 +4,28 @@
   Output: convex polygon 
   Time complexity: O(nlogn), n is # of input points
   Method: Graham scan 
+  Parallel mode (-t p): monotone chain instead of the angular sort; the points are cut
+      into p chunks, every thread sorts its chunk by (x, y) and chains its hull, then
+      the chunk hulls are merged pairwise in a tree reduction, a merge chains the two
+      (x, y) sorted vertex lists merged in linear time -> O(n/p*log(n/p)+h*logp) for
+      h hull vertices per chunk; the output keeps the format, counterclockwise from
+      the lowest (then leftmost) point, without collinear or repeated points (the
+      Graham scan keeps collinear boundary points); the points are parsed by hand from
+      blocks read with fread, scanf would take longer than the hull itself
 
  ************************************************************************************/
 
 #include <algorithm>
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 #include <vector>
 
+#define IO_BLOCK_SIZE (1<<16) // bytes read at once in parallel mode
+#define EXACT_COORD   (1LL<<30) // |coordinate| up to which turn_sign stays in long long
+
 class point
 {
     public:
@@ -20,6 +34,32 @@ class point
         long long int x, y; /* x, y coordinates */
 };
 
+// block reader of the points of parallel mode, parsing without scanf
+class input_buffer
+{
+    public:
+        input_buffer( FILE *f ) { file = f; pos = 0; len = 0; buffer.resize( IO_BLOCK_SIZE ); }
+
+        // next character, EOF if the stream is exhausted
+        int get( void )
+        {
+            if( pos == len )
+            {
+                len = fread( &(buffer[0]), 1, IO_BLOCK_SIZE, file );
+                pos = 0;
+
+                if( len == 0 )
+                    return EOF;
+            }
+
+            return static_cast<unsigned char>( buffer[pos++] );
+        }
+
+        FILE             *file;
+        std::vector<char> buffer;
+        size_t            pos, len;
+};
+
 using std::vector;
 
 /* global variable */
@@ -27,28 +67,257 @@ point minPoint(0, 0);
 
 bool cmp_small_angle( const point &p1, const point &p2 );
 
-double cross( const point &i, const point &j, const point &k );
+bool next_integer( input_buffer &in, long long int &value );
+
+bool cmp_small_xy( const point &p1, const point &p2 );
+
+bool same_point( const point &p1, const point &p2 );
+
+bool small_coord( const point &p );
+
+int turn_sign( const point &i, const point &j, const point &k );
+
+void chain_hull( const vector<point> &sorted_vec, vector<point> &lower, vector<point> &upper );
+
+void hull_vertex( const vector<point> &sorted_vec, vector<point> &hull_vec );
+
+void chunk_hull( vector<point> &point_vec, unsigned begin, unsigned end, vector<point> &hull_vec );
+
+void hull_merge( vector<point> &hull_vec, const vector<point> &other_vec );
+
+void parallel_hull( vector<point> &point_vec, unsigned thread_no, vector<point> &polygon );
 
 /* comparison function - ascending sort (p1 angle < p2 angle ) */
 bool cmp_small_angle( const point &p1, const point &p2 )
 {
-    return ( cross(minPoint, p1, p2)>0 );
+    return ( turn_sign(minPoint, p1, p2)>0 );
+}
+
+/* parse the next (signed) integer, false if the stream is exhausted */
+bool next_integer( input_buffer &in, long long int &value )
+{
+    int c = in.get();
+
+    while( c != EOF && (c == ' ' || c == '\n' || c == '\r' || c == '\t') )
+        c = in.get();
+
+    bool is_negative = ( c == '-' );
+
+    if( c == '-' || c == '+' )
+        c = in.get();
+
+    if( c < '0' || c > '9' )
+        return false;
+
+    for( value = 0; c >= '0' && c <= '9'; c = in.get() )
+        value = value*10 + (c-'0');
+
+    if( is_negative )
+        value = -value;
+
+    return true;
+}
+
+/* comparison function - ascending sort by x, then y */
+bool cmp_small_xy( const point &p1, const point &p2 )
+{
+    if( p1.x != p2.x )
+        return ( p1.x < p2.x );
+    else
+        return ( p1.y < p2.y );
+}
+
+bool same_point( const point &p1, const point &p2 )
+{
+    return ( p1.x == p2.x && p1.y == p2.y );
+}
+
+bool small_coord( const point &p )
+{
+    return ( -EXACT_COORD <= p.x && p.x <= EXACT_COORD && -EXACT_COORD <= p.y && p.y <= EXACT_COORD );
+}
+
+/* sign of the cross, i.e. determinant, computed exactly: within EXACT_COORD every product stays
+   below 2^62, beyond it in __int128; a double would round a determinant of +-1 to 0 above 2^53 */
+int turn_sign( const point &i, const point &j, const point &k )
+{
+    if( small_coord(i) && small_coord(j) && small_coord(k) )
+    {
+        long long int det = (j.x - i.x)*(k.y - i.y) - (k.x - i.x)*(j.y - i.y);
+        return ( det > 0 ) - ( det < 0 );
+    }
+
+    __int128 jx = static_cast<__int128>(j.x) - i.x, jy = static_cast<__int128>(j.y) - i.y; // differences may pass 2^63
+    __int128 kx = static_cast<__int128>(k.x) - i.x, ky = static_cast<__int128>(k.y) - i.y;
+    __int128 det = jx*ky - kx*jy;
+    return ( det > 0 ) - ( det < 0 );
+}
+
+/* monotone chain over distinct points sorted by cmp_small_xy, both chains run from the leftmost
+   to the rightmost point and keep strict turns only (lower turns left, upper turns right) */
+void chain_hull( const vector<point> &sorted_vec, vector<point> &lower, vector<point> &upper )
+{
+    lower.clear();
+    upper.clear();
+
+    for( unsigned i=0; i<sorted_vec.size(); ++i )
+    {
+        while( lower.size() >= 2 && turn_sign(lower[lower.size()-2], lower.back(), sorted_vec[i]) <= 0 )
+            lower.pop_back();
+
+        while( upper.size() >= 2 && turn_sign(upper[upper.size()-2], upper.back(), sorted_vec[i]) >= 0 )
+            upper.pop_back();
+
+        lower.push_back( sorted_vec[i] );
+        upper.push_back( sorted_vec[i] );
+    }
+}
+
+/* hull vertices of the sorted distinct points, themselves sorted by cmp_small_xy */
+void hull_vertex( const vector<point> &sorted_vec, vector<point> &hull_vec )
+{
+    vector<point> lower, upper;
+    chain_hull( sorted_vec, lower, upper );
+
+    // both chains hold the two end points
+    hull_vec.resize( lower.size()+upper.size() );
+    hull_vec.erase( std::unique( hull_vec.begin(), std::merge( lower.begin(), lower.end(), upper.begin(), upper.end(), hull_vec.begin(), cmp_small_xy ), same_point ),
+                    hull_vec.end() );
+}
+
+/* hull of point_vec[begin]~point_vec[end-1], sorts that part in place */
+void chunk_hull( vector<point> &point_vec, unsigned begin, unsigned end, vector<point> &hull_vec )
+{
+    std::sort( point_vec.begin()+begin, point_vec.begin()+end, cmp_small_xy );
+
+    vector<point> sorted_vec( point_vec.begin()+begin, point_vec.begin()+end );
+    sorted_vec.erase( std::unique( sorted_vec.begin(), sorted_vec.end(), same_point ), sorted_vec.end() );
+
+    hull_vertex( sorted_vec, hull_vec );
+}
+
+/* hull_vec becomes the hull of both vertex lists, a linear merge keeps them sorted */
+void hull_merge( vector<point> &hull_vec, const vector<point> &other_vec )
+{
+    vector<point> sorted_vec( hull_vec.size()+other_vec.size() );
+    sorted_vec.erase( std::unique( sorted_vec.begin(), std::merge( hull_vec.begin(), hull_vec.end(), other_vec.begin(), other_vec.end(), sorted_vec.begin(), cmp_small_xy ), same_point ),
+                      sorted_vec.end() );
+
+    hull_vertex( sorted_vec, hull_vec );
 }
 
-/* cross, i.e. determinant */
-double cross( const point &i, const point &j, const point &k ) 
-{ 
-    return ( static_cast<double>((j.x - i.x))*(k.y - i.y) - static_cast<double>((k.x - i.x))*(j.y - i.y) ); 
-} 
+/* polygon is counterclockwise from the lowest (then leftmost) point */
+void parallel_hull( vector<point> &point_vec, unsigned thread_no, vector<point> &polygon )
+{
+    unsigned point_no = point_vec.size();
+    thread_no = std::max( 1u, std::min( thread_no, point_no ) );
+
+    vector< vector<point> > hull_set( thread_no ); // hull of each chunk, then of each merged group
+    vector<std::thread>     thread_set;
+
+    for( unsigned t=0; t<thread_no; ++t )
+    {
+        unsigned begin = static_cast<unsigned>( static_cast<unsigned long long>(point_no)*t/thread_no );
+        unsigned end   = static_cast<unsigned>( static_cast<unsigned long long>(point_no)*(t+1)/thread_no );
+        thread_set.push_back( std::thread( chunk_hull, std::ref(point_vec), begin, end, std::ref(hull_set[t]) ) );
+    }
+
+    for( unsigned t=0; t<thread_no; ++t )
+        thread_set[t].join();
+
+    /* tree reduction, hull_set[t] takes hull_set[t+step] at every level */
+
+    for( unsigned step=1; step<thread_no; step*=2 )
+    {
+        thread_set.clear();
+
+        for( unsigned t=0; t+step<thread_no; t+=2*step )
+            thread_set.push_back( std::thread( hull_merge, std::ref(hull_set[t]), std::cref(hull_set[t+step]) ) );
+
+        for( unsigned i=0; i<thread_set.size(); ++i )
+            thread_set[i].join();
+    }
+
+    /* lower chain forward and upper chain backward, without repeating their end points */
+
+    vector<point> lower, upper;
+    chain_hull( hull_set[0], lower, upper );
+
+    polygon = lower;
+
+    for( unsigned i=upper.size()-1; i-- > 1; )
+        polygon.push_back( upper[i] );
+
+    unsigned start_id = 0;
 
+    for( unsigned i=1; i<polygon.size(); ++i )
+    {
+        if( polygon[i].y < polygon[start_id].y || (polygon[i].y == polygon[start_id].y && polygon[i].x < polygon[start_id].x) )
+            start_id = i;
+    }
+
+    std::rotate( polygon.begin(), polygon.begin()+start_id, polygon.end() );
+}
+
+// usage: cvx_hull [-t p]
+//   -t p parallel mode, p threads; unlike the default Graham scan it drops collinear and
+//        repeated boundary points
 int main( int argc, char **argv )
 {
     /* read point num and do initialization */
 
     //freopen( "../convex_case/case2.in", "r", stdin );
 
+    unsigned thread_no = 0;
+
+    for( int i=1; i<argc; ++i )
+    {
+        if( strcmp( argv[i], "-t" ) == 0 && i+1 < argc )
+        {
+            thread_no = static_cast<unsigned>(atoi( argv[++i] ));
+
+            if( thread_no == 0 )
+                thread_no = 1;
+        }
+        else
+        {
+            fprintf( stderr, "usage: %s [-t p]\n  -t p  parallel mode, p threads, drops collinear and repeated boundary points\n", argv[0] );
+            return 1;
+        }
+    }
+
     unsigned point_no, point_vec_size;
     scanf( "%u", &point_no );
+
+    if( thread_no > 0 && point_no > 0 )
+    {
+        vector<point> point_vec( point_no ), polygon;
+        input_buffer  in( stdin );
+
+        for( unsigned i=0; i<point_no; ++i )
+        {
+            if( !next_integer( in, point_vec[i].x ) || !next_integer( in, point_vec[i].y ) )
+            {
+                point_vec.resize( i );
+                break;
+            }
+        }
+
+        if( point_vec.empty() )
+        {
+            printf( "0\n" );
+            return 0;
+        }
+
+        parallel_hull( point_vec, thread_no, polygon );
+
+        printf( "%u\n", static_cast<unsigned>(polygon.size()) );
+
+        for( unsigned i=0; i<polygon.size(); ++i )
+            printf( "%lld %lld\n", polygon[i].x, polygon[i].y );
+
+        return 0;
+    }
     point_vec_size = point_no + 1;
 
     vector<point> point_vec;
@@ -116,7 +385,7 @@ int main( int argc, char **argv )
 
     for( unsigned i=3; i<point_vec_size; ++i )
     {
-        while( cross(point_vec[check-1], point_vec[check], point_vec[i]) < 0 )
+        while( turn_sign(point_vec[check-1], point_vec[check], point_vec[i]) < 0 )
             check -= 1;
 
         check += 1;
@@ -0,0 +1,306 @@
+/*************************************************************************************
+
+  Input: (command line) n intervals, k commands, random seed
+  Output: construction and update time of segment_tree.h and of the hand-written
+          pointer-linked tree the tools carried before, union length after the last
+          command of both
+  Time complexity: O(n*logn+k*logn) for each tree
+  Method used: random intervals over [0, 1e6), k random insertions and deletions
+               applied in the same order to both trees, the union length is read after
+               every command and both sums are compared
+
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "segment_tree.h"
+
+#define NDEBUG
+#define PRECISION 0.000001
+
+// --------------- class definition --------------- //
+
+// tree node of the hand-written segment tree (node vector built recursively, parent links)
+class hand_node
+{
+    public:
+        hand_node(void)
+        {
+            key            = 0;
+            leftChild_id   = 0;
+            rightChild_id  = 0;
+            intervalCount  = 0;
+            subtreeRLength = 0.0;
+        }
+
+        unsigned key;
+        double   rLeft_x, rRight_x; // real left x, real right x
+        double   rLength;           // rRight_x-rLeft_x
+        unsigned left_x, right_x;
+        unsigned parent_id;    // 0 if it is root
+        unsigned leftChild_id, rightChild_id;
+
+        unsigned intervalCount;
+        double subtreeRLength; // interval length of the subtree
+};
+
+// --------------- function declaration --------------- //
+
+void hand_update( unsigned cur_id, std::vector<hand_node> &tree, double interval_length );
+
+void hand_deletion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, std::vector<hand_node> &tree );
+
+void hand_insertion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, std::vector<hand_node> &tree );
+
+double hand_length( const hand_node &root );
+
+void hand_construct( std::vector<hand_node> &tree, const std::vector<double> &map_to_real, unsigned global_max_x );
+
+unsigned next_random( unsigned long long &state );
+
+using std::vector;
+
+// --------------- function definition --------------- //
+
+// update towards root after insertion
+void hand_update( unsigned cur_id, vector<hand_node> &tree, double interval_length )
+{
+    // has been inserted or hit the root
+    if( tree[cur_id].intervalCount > 0 || cur_id == 1 )
+    {
+        tree[cur_id].subtreeRLength += interval_length;
+        return;
+    }
+    else
+    {
+        tree[cur_id].subtreeRLength += interval_length;
+        hand_update( tree[cur_id].parent_id, tree, interval_length );
+    }
+
+    return;
+}
+
+void hand_deletion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, vector<hand_node> &tree )
+{
+    if( (target_left_x <= tree[cur_id].left_x) && (target_right_x >= tree[cur_id].right_x) )
+    {
+        assert( tree[cur_id].intervalCount > 0 );
+        (tree[cur_id].intervalCount)--;
+
+        if( tree[cur_id].intervalCount == 0 && cur_id != 1 )
+            hand_update( tree[cur_id].parent_id, tree, tree[cur_id].subtreeRLength-tree[cur_id].rLength );
+
+        return;
+    }
+
+    if( target_left_x < tree[cur_id].key )
+        hand_deletion( target_left_x, target_right_x, tree[cur_id].leftChild_id, tree );
+
+    if( target_right_x > tree[cur_id].key )
+        hand_deletion( target_left_x, target_right_x, tree[cur_id].rightChild_id, tree );
+
+    return;
+}
+
+// insert an interval and do update towards root
+void hand_insertion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, vector<hand_node> &tree )
+{
+    if( (target_left_x <= tree[cur_id].left_x) && (target_right_x >= tree[cur_id].right_x) )
+    {
+        if( tree[cur_id].intervalCount == 0 && cur_id != 1 )
+            hand_update( tree[cur_id].parent_id, tree, tree[cur_id].rLength-tree[cur_id].subtreeRLength );
+
+        (tree[cur_id].intervalCount)++;
+        return;
+    }
+
+    if( target_left_x < tree[cur_id].key )
+        hand_insertion( target_left_x, target_right_x, tree[cur_id].leftChild_id, tree );
+
+    if( target_right_x > tree[cur_id].key )
+        hand_insertion( target_left_x, target_right_x, tree[cur_id].rightChild_id, tree );
+
+    return;
+}
+
+double hand_length( const hand_node &root )
+{
+    if( root.intervalCount == 0 )
+        return root.subtreeRLength;
+    else
+        return root.rLength;
+}
+
+// construct segment tree, nodes are appended breadth-first
+void hand_construct( vector<hand_node> &tree, const vector<double> &map_to_real, unsigned global_max_x )
+{
+    tree.resize( 2 );
+    tree[1].rLeft_x   = map_to_real[1];
+    tree[1].rRight_x  = map_to_real[global_max_x];
+    tree[1].rLength   = tree[1].rRight_x - tree[1].rLeft_x;
+    tree[1].left_x    = 1;
+    tree[1].right_x   = global_max_x;
+    tree[1].parent_id = 0;
+
+    unsigned key, tree_size, right_id; // temporary variables
+
+    for( unsigned i=1; i<tree.size(); ++i )
+    {
+        if( (tree[i].right_x - tree[i].left_x) <= 1 )
+            continue;
+
+        key = (tree[i].left_x + tree[i].right_x)/2;
+        tree[i].key = key;
+
+        tree_size = tree.size();
+        tree.resize( tree_size+2 );
+        right_id = tree_size+1;
+
+        tree[i].leftChild_id  = tree_size;
+        tree[i].rightChild_id = right_id;
+
+        // construct left sub-tree
+        tree[tree_size].rLeft_x   = map_to_real[tree[i].left_x];
+        tree[tree_size].rRight_x  = map_to_real[key];
+        tree[tree_size].rLength   = tree[tree_size].rRight_x - tree[tree_size].rLeft_x;
+        tree[tree_size].left_x    = tree[i].left_x;
+        tree[tree_size].right_x   = key;
+        tree[tree_size].parent_id = i;
+
+        // construct right sub-tree
+        tree[right_id].rLeft_x   = map_to_real[key];
+        tree[right_id].rRight_x  = map_to_real[tree[i].right_x];
+        tree[right_id].rLength   = tree[right_id].rRight_x - tree[right_id].rLeft_x;
+        tree[right_id].left_x    = key;
+        tree[right_id].right_x   = tree[i].right_x;
+        tree[right_id].parent_id = i;
+    }
+
+    return;
+}
+
+// 64-bit linear congruential generator, the same trace for the same seed on every platform
+inline unsigned next_random( unsigned long long &state )
+{
+    state = state*6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<unsigned>(state >> 33);
+}
+
+// --------------- main function --------------- //
+
+// usage: bench_segment_tree [n] [k] [seed]
+int main( int argc, char **argv )
+{
+    unsigned interval_no = (argc > 1) ? static_cast<unsigned>(atoi( argv[1] )) : 200000;
+    unsigned command_no  = (argc > 2) ? static_cast<unsigned>(atoi( argv[2] )) : 2000000;
+    unsigned long long state = (argc > 3) ? static_cast<unsigned long long>(atoll( argv[3] )) : 1;
+
+    if( interval_no == 0 )
+        interval_no = 1;
+
+    vector< interval<double> > interval_set( interval_no+1 ); // (use +1 offset)
+    vector< endpoint<double> > endpoint_set( interval_no*2 );  // (use no offset)
+
+    for( unsigned i=1, e_id=0; i<=interval_no; ++i )
+    {
+        double left  = next_random( state ) % 1000000;
+        double right = left + 1 + next_random( state ) % 50000;
+
+        interval_set[i].rLeft_x  = left;
+        interval_set[i].rRight_x = right;
+        interval_set[i].rLength  = right-left;
+        endpoint_set[e_id++].init( left, i, true );
+        endpoint_set[e_id++].init( right, i, false );
+    }
+
+    vector<double> map_to_real; // (use +1 offset)
+    unsigned global_max_x = compress_endpoints( endpoint_set, interval_set, map_to_real );
+
+    // a command toggles a random interval, so that about half of them are stored at any time
+    vector<unsigned> command_set( command_no );
+
+    for( unsigned i=0; i<command_no; ++i )
+        command_set[i] = 1 + next_random( state ) % interval_no;
+
+    typedef std::chrono::steady_clock clock_type;
+    vector<bool> in_tree;
+    double       shared_sum = 0.0, hand_sum = 0.0;
+    double       shared_build, shared_run, hand_build, hand_run;
+
+    { // segment_tree.h
+        clock_type::time_point start = clock_type::now();
+        segment_tree<double> tree;
+        tree_construct( tree, map_to_real, global_max_x );
+        clock_type::time_point built = clock_type::now();
+
+        in_tree.assign( interval_no+1, false );
+
+        for( unsigned i=0; i<command_no; ++i )
+        {
+            const interval<double> &target = interval_set[command_set[i]];
+
+            if( in_tree[command_set[i]] )
+                interval_deletion( target.left_x, target.right_x, tree );
+            else
+                interval_insertion( target.left_x, target.right_x, tree );
+
+            in_tree[command_set[i]] = !in_tree[command_set[i]];
+            shared_sum += covered_length( tree, 1 );
+        }
+
+        clock_type::time_point done = clock_type::now();
+        shared_build = std::chrono::duration<double>( built-start ).count();
+        shared_run   = std::chrono::duration<double>( done-built ).count();
+    }
+
+    { // hand-written tree
+        clock_type::time_point start = clock_type::now();
+        vector<hand_node> tree; // (use +1 offset)
+        hand_construct( tree, map_to_real, global_max_x );
+        clock_type::time_point built = clock_type::now();
+
+        in_tree.assign( interval_no+1, false );
+
+        for( unsigned i=0; i<command_no; ++i )
+        {
+            const interval<double> &target = interval_set[command_set[i]];
+
+            if( in_tree[command_set[i]] )
+                hand_deletion( target.left_x, target.right_x, 1, tree );
+            else
+                hand_insertion( target.left_x, target.right_x, 1, tree );
+
+            in_tree[command_set[i]] = !in_tree[command_set[i]];
+            hand_sum += hand_length( tree[1] );
+        }
+
+        clock_type::time_point done = clock_type::now();
+        hand_build = std::chrono::duration<double>( built-start ).count();
+        hand_run   = std::chrono::duration<double>( done-built ).count();
+    }
+
+    printf( "%u intervals, %u commands\n", interval_no, command_no );
+    printf( "segment_tree.h: build %.3lf ms, updates %.3lf ms, %.0lf commands/s\n", shared_build*1e3, shared_run*1e3,
+            (shared_run > 0.0) ? command_no/shared_run : 0.0 );
+    printf( "hand-written:   build %.3lf ms, updates %.3lf ms, %.0lf commands/s\n", hand_build*1e3, hand_run*1e3,
+            (hand_run > 0.0) ? command_no/hand_run : 0.0 );
+
+    // the hand-written tree accumulates length differences, allow for its rounding
+    double tolerance = PRECISION * std::max( 1.0, fabs(hand_sum) );
+
+    if( fabs( shared_sum-hand_sum ) > tolerance )
+    {
+        printf( "MISMATCH: %lf vs %lf\n", shared_sum, hand_sum );
+        return 1;
+    }
+
+    printf( "union length sums match: %lf\n", shared_sum );
+
+    return 0;
+}
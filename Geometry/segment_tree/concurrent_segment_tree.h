@@ -0,0 +1,493 @@
+/*************************************************************************************
+
+  Header-only concurrent front ends of segment_tree.h, shared by segment_tree.cpp
+  and replay_segment_tree.cpp
+
+  sharded_tree - the elementary segments are split into shards of equal size, each
+                 with its own tree and lock, an interval spanning shards is split at
+                 the shard boundaries and the union length is the sum of the shard
+                 roots; disjoint updates run in parallel
+  snapshot_domain - single writer, lock-free readers of immutable snapshots of the
+                 writer's tree; snapshots share the unchanged node blocks through a
+                 persistent radix index of pages, a publish copies only the changed
+                 blocks and the pages on their paths, and a snapshot is reclaimed once
+                 no reader holds an epoch at or before its retirement
+  Time complexity: sharded update O(s*logn) for s touched shards, publish
+                   O(d*(PAGE+BLOCK)*log(n/BLOCK)) for d changed blocks, snapshot
+                   union length O(log(n/BLOCK))
+
+ ************************************************************************************/
+
+#ifndef CONCURRENT_SEGMENT_TREE_H
+#define CONCURRENT_SEGMENT_TREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "segment_tree.h"
+
+#ifndef BLOCK_BITS
+#define BLOCK_BITS 6 // 64 nodes per copy-on-write block of a snapshot
+#endif
+
+#ifndef PAGE_BITS
+#define PAGE_BITS  5 // 32 children per page of the block index of a snapshot
+#endif
+
+// --------------- class definition --------------- //
+
+// shard of the concurrent tree, owns the elementary segments between two mapped coordinates
+class shard
+{
+    public:
+        shard(void) { first_x = 1; last_x = 1; rootLength = 0.0; }
+
+        unsigned     first_x, last_x; // mapped coordinates spanned by the shard
+        segment_tree<double> tree;    // over map_to_real[first_x..last_x], shifted to start from 1
+        double       rootLength;      // union length inside the shard, guarded by lock
+        std::mutex   lock;
+};
+
+// concurrent tree made of independent shards
+class sharded_tree
+{
+    public:
+        sharded_tree( unsigned shard_no ) : shard_set( shard_no ) { shard_span = 1; }
+
+        unsigned           shard_span; // # of elementary segments per shard, the last one may have fewer
+        std::vector<shard> shard_set;
+};
+
+// copy-on-write block of intervalCount/subtreeRLength, shared by the snapshots not changing it
+class node_block
+{
+    public:
+        unsigned intervalCount[1 << BLOCK_BITS];
+        double   subtreeRLength[1 << BLOCK_BITS];
+        unsigned ref_count; // # of pages pointing to the block, writer only
+};
+
+// page of the persistent block index, shared by the snapshots not changing any block below it;
+// pages of level 0 point to blocks, the others to the pages of the level below
+class block_page
+{
+    public:
+        block_page *child[1 << PAGE_BITS];
+        node_block *block[1 << PAGE_BITS];
+        unsigned    ref_count; // # of snapshots and pages pointing to the page, writer only
+        unsigned    version;   // publish that created the page, it is private to that publish
+};
+
+// immutable view of the segment tree, rLength never changes and is shared with the writer
+class tree_snapshot
+{
+    public:
+        unsigned           leaf_base;
+        const double      *rLength;
+        block_page        *root;
+        unsigned           height; // # of levels of the block index
+        unsigned long long retire_epoch;
+};
+
+// single-writer multi-reader publication of snapshots with epoch-based reclamation
+// a reader announces the global epoch before loading current and clears it when done,
+// a snapshot retired at epoch e is freed once every announced epoch is greater than e
+class snapshot_domain
+{
+    public:
+        snapshot_domain( unsigned reader_no ) : reader_epoch( reader_no )
+        {
+            current = NULL;
+            global_epoch = 1;
+            version = 0;
+
+            for( unsigned r=0; r<reader_no; ++r )
+                reader_epoch[r] = 0;
+        }
+
+        std::atomic<tree_snapshot *>                  current;
+        std::atomic<unsigned long long>               global_epoch;
+        std::vector< std::atomic<unsigned long long> > reader_epoch; // 0 if not reading
+
+        std::vector<tree_snapshot *> retired;     // writer only
+        std::vector<unsigned>        dirty_block; // blocks changed since the last publish, writer only
+        std::vector<bool>            is_dirty;
+        unsigned                     version;     // # of publishes so far, writer only
+};
+
+// --------------- function declaration --------------- //
+
+void sharded_construct( sharded_tree &forest, const std::vector<double> &map_to_real, unsigned global_max_x );
+
+void sharded_update( unsigned target_left_x, unsigned target_right_x, bool is_insertion, sharded_tree &forest );
+
+double sharded_length( sharded_tree &forest );
+
+unsigned node_count( const tree_snapshot &snapshot, unsigned cur_id );
+
+double node_subtree_length( const tree_snapshot &snapshot, unsigned cur_id );
+
+double snapshot_length( const tree_snapshot &snapshot );
+
+template <class tree_type>
+void snapshot_mark( unsigned target_left_x, unsigned target_right_x, const tree_type &tree, snapshot_domain &domain );
+
+const node_block *snapshot_block( const tree_snapshot &snapshot, unsigned cur_id );
+
+block_page *page_private( block_page *page, unsigned level, unsigned version );
+
+void page_release( block_page *page, unsigned level );
+
+template <class tree_type>
+void snapshot_publish( const tree_type &tree, snapshot_domain &domain );
+
+void snapshot_free( tree_snapshot *snapshot );
+
+void snapshot_reclaim( snapshot_domain &domain, bool is_final );
+
+const tree_snapshot *snapshot_acquire( snapshot_domain &domain, unsigned reader_id );
+
+void snapshot_release( snapshot_domain &domain, unsigned reader_id );
+
+// --------------- function definition --------------- //
+
+// split the elementary segments evenly, every shard builds its tree on its slice of map_to_real
+inline void sharded_construct( sharded_tree &forest, const std::vector<double> &map_to_real, unsigned global_max_x )
+{
+    unsigned shard_no   = forest.shard_set.size();
+    unsigned segment_no = (global_max_x > 1) ? global_max_x-1 : 1;
+    forest.shard_span   = (segment_no + shard_no - 1) / shard_no;
+
+    for( unsigned s=0; s<shard_no; ++s )
+    {
+        shard &cur = forest.shard_set[s];
+        cur.first_x = std::min( s*forest.shard_span+1, global_max_x );
+        cur.last_x  = std::min( (s+1)*forest.shard_span+1, global_max_x );
+
+        std::vector<double> local_map( 1, 0.0 ); // (use +1 offset)
+        local_map.insert( local_map.end(), map_to_real.begin()+cur.first_x, map_to_real.begin()+cur.last_x+1 );
+        tree_construct( cur.tree, local_map, cur.last_x-cur.first_x+1 );
+    }
+
+    return;
+}
+
+// insert or delete [target_left_x, target_right_x], cut at the shard boundaries
+// only the touched shards are locked, one at a time, so disjoint updates run in parallel
+inline void sharded_update( unsigned target_left_x, unsigned target_right_x, bool is_insertion, sharded_tree &forest )
+{
+    if( target_left_x >= target_right_x )
+        return;
+
+    unsigned first_shard = (target_left_x-1) / forest.shard_span;
+    unsigned last_shard  = (target_right_x-2) / forest.shard_span;
+
+    for( unsigned s=first_shard; s<=last_shard; ++s )
+    {
+        shard &cur = forest.shard_set[s];
+        unsigned local_left_x  = std::max( target_left_x, cur.first_x ) - cur.first_x + 1;
+        unsigned local_right_x = std::min( target_right_x, cur.last_x ) - cur.first_x + 1;
+
+        std::lock_guard<std::mutex> guard( cur.lock );
+
+        if( is_insertion )
+            interval_insertion( local_left_x, local_right_x, cur.tree );
+        else
+            interval_deletion( local_left_x, local_right_x, cur.tree );
+
+        cur.rootLength = covered_length( cur.tree, 1 );
+    }
+
+    return;
+}
+
+// union length once the producers are done
+inline double sharded_length( sharded_tree &forest )
+{
+    double length = 0.0;
+
+    for( unsigned s=0; s<forest.shard_set.size(); ++s )
+    {
+        std::lock_guard<std::mutex> guard( forest.shard_set[s].lock );
+        length += forest.shard_set[s].rootLength;
+    }
+
+    return length;
+}
+
+// block holding node cur_id, one page per level of the index
+inline const node_block *snapshot_block( const tree_snapshot &snapshot, unsigned cur_id )
+{
+    const unsigned    page_mask = (1 << PAGE_BITS)-1;
+    unsigned          block_id  = cur_id >> BLOCK_BITS;
+    const block_page *page      = snapshot.root;
+
+    for( unsigned level = snapshot.height-1; level > 0; --level )
+        page = page->child[(block_id >> (level*PAGE_BITS)) & page_mask];
+
+    return page->block[block_id & page_mask];
+}
+
+inline unsigned node_count( const tree_snapshot &snapshot, unsigned cur_id )
+{
+    return snapshot_block( snapshot, cur_id )->intervalCount[cur_id & ((1 << BLOCK_BITS)-1)];
+}
+
+inline double node_subtree_length( const tree_snapshot &snapshot, unsigned cur_id )
+{
+    return snapshot_block( snapshot, cur_id )->subtreeRLength[cur_id & ((1 << BLOCK_BITS)-1)];
+}
+
+inline double snapshot_length( const tree_snapshot &snapshot )
+{
+    if( node_count( snapshot, 1 ) > 0 )
+        return snapshot.rLength[1];
+    else
+        return node_subtree_length( snapshot, 1 );
+}
+
+// mark the blocks an insertion or deletion of [target_left_x, target_right_x] writes to:
+// its canonical nodes and the ancestors of its first and last leaf
+template <class tree_type>
+void snapshot_mark( unsigned target_left_x, unsigned target_right_x, const tree_type &tree, snapshot_domain &domain )
+{
+    unsigned left_id  = tree.leaf_base + target_left_x - 1;
+    unsigned right_id = tree.leaf_base + target_right_x - 1;
+    std::vector<unsigned> node_id;
+
+    if( left_id >= right_id )
+        return;
+
+    for( unsigned cur_id = left_id; cur_id > 0; cur_id >>= 1 )
+        node_id.push_back( cur_id );
+
+    for( unsigned cur_id = right_id-1; cur_id > 0; cur_id >>= 1 )
+        node_id.push_back( cur_id );
+
+    for( ; left_id < right_id; left_id >>= 1, right_id >>= 1 )
+    {
+        if( left_id & 1 )
+            node_id.push_back( left_id++ );
+
+        if( right_id & 1 )
+            node_id.push_back( --right_id );
+    }
+
+    for( unsigned i=0; i<node_id.size(); ++i )
+    {
+        unsigned block_id = node_id[i] >> BLOCK_BITS;
+
+        if( !domain.is_dirty[block_id] )
+        {
+            domain.is_dirty[block_id] = true;
+            domain.dirty_block.push_back( block_id );
+        }
+    }
+
+    return;
+}
+
+// copy of the page of the given level owned by the publish of version, the children gain a
+// reference (a NULL page becomes an empty one); the caller drops its reference to the old page
+inline block_page *page_private( block_page *page, unsigned level, unsigned version )
+{
+    block_page *copy = new block_page;
+
+    memset( copy->child, 0, sizeof(copy->child) );
+    memset( copy->block, 0, sizeof(copy->block) );
+
+    if( page != NULL && level > 0 )
+    {
+        memcpy( copy->child, page->child, sizeof(copy->child) );
+
+        for( unsigned c=0; c<(1u << PAGE_BITS); ++c )
+        {
+            if( copy->child[c] != NULL )
+                (copy->child[c]->ref_count)++;
+        }
+    }
+    else if( page != NULL )
+    {
+        memcpy( copy->block, page->block, sizeof(copy->block) );
+
+        for( unsigned c=0; c<(1u << PAGE_BITS); ++c )
+        {
+            if( copy->block[c] != NULL )
+                (copy->block[c]->ref_count)++;
+        }
+    }
+
+    copy->ref_count = 1;
+    copy->version   = version;
+
+    return copy;
+}
+
+// drop one reference to the page of the given level, the pages and blocks only it held go with it
+inline void page_release( block_page *page, unsigned level )
+{
+    if( page == NULL || --(page->ref_count) > 0 )
+        return;
+
+    for( unsigned c=0; c<(1u << PAGE_BITS); ++c )
+    {
+        if( level > 0 )
+            page_release( page->child[c], level-1 );
+        else if( page->block[c] != NULL && --(page->block[c]->ref_count) == 0 )
+            delete page->block[c];
+    }
+
+    delete page;
+}
+
+// publish the writer's tree by path copying: the dirty blocks and the pages on their paths are
+// new, everything else is shared with the previous snapshot -> O(d*(64+BLOCK)) for d dirty
+// blocks; nothing is published if no block changed since the last publish
+template <class tree_type>
+void snapshot_publish( const tree_type &tree, snapshot_domain &domain )
+{
+    const unsigned block_size = 1 << BLOCK_BITS, page_mask = (1 << PAGE_BITS)-1;
+    unsigned block_no = (2*tree.leaf_base + block_size-1) / block_size;
+
+    tree_snapshot *last = domain.current.load();
+
+    if( last == NULL ) // first snapshot, every block is new
+    {
+        domain.is_dirty.assign( block_no, true );
+        domain.dirty_block.clear();
+
+        for( unsigned b=0; b<block_no; ++b )
+            domain.dirty_block.push_back( b );
+    }
+    else if( domain.dirty_block.empty() )
+        return;
+
+    unsigned version = ++(domain.version);
+
+    tree_snapshot *snapshot = new tree_snapshot;
+    snapshot->leaf_base    = tree.leaf_base;
+    snapshot->rLength      = &(tree.rLength[0]);
+    snapshot->retire_epoch = 0;
+
+    if( last == NULL )
+    {
+        snapshot->height = 1;
+
+        while( (1ULL << (snapshot->height*PAGE_BITS)) < block_no )
+            snapshot->height++;
+
+        snapshot->root = page_private( NULL, snapshot->height-1, version );
+    }
+    else
+    {
+        snapshot->height = last->height;
+        snapshot->root   = page_private( last->root, snapshot->height-1, version );
+    }
+
+    for( unsigned i=0; i<domain.dirty_block.size(); ++i )
+    {
+        unsigned block_id = domain.dirty_block[i];
+        domain.is_dirty[block_id] = false;
+
+        // make the path private, the pages copied once per publish
+        block_page *page = snapshot->root;
+
+        for( unsigned level = snapshot->height-1; level > 0; --level )
+        {
+            block_page *&child = page->child[(block_id >> (level*PAGE_BITS)) & page_mask];
+
+            if( child == NULL || child->version != version )
+            {
+                block_page *copy = page_private( child, level-1, version );
+                page_release( child, level-1 );
+                child = copy;
+            }
+
+            page = child;
+        }
+
+        node_block *&slot  = page->block[block_id & page_mask];
+        node_block  *block = new node_block;
+        unsigned first_id  = block_id << BLOCK_BITS;
+        unsigned node_no   = std::min( block_size, 2*tree.leaf_base - first_id );
+
+        memset( block, 0, sizeof(node_block) );
+        memcpy( block->intervalCount, &(tree.intervalCount[first_id]), node_no*sizeof(unsigned) );
+        memcpy( block->subtreeRLength, &(tree.subtreeRLength[first_id]), node_no*sizeof(double) );
+        block->ref_count = 1;
+
+        if( slot != NULL && --(slot->ref_count) == 0 )
+            delete slot;
+
+        slot = block;
+    }
+
+    domain.dirty_block.clear();
+
+    tree_snapshot *old = domain.current.exchange( snapshot );
+
+    if( old != NULL )
+    {
+        old->retire_epoch = domain.global_epoch.fetch_add( 1 );
+        domain.retired.push_back( old );
+    }
+
+    snapshot_reclaim( domain, false );
+
+    return;
+}
+
+// only the pages no newer snapshot shares are visited
+inline void snapshot_free( tree_snapshot *snapshot )
+{
+    page_release( snapshot->root, snapshot->height-1 );
+    delete snapshot;
+}
+
+// free the retired snapshots no reader can still hold, all of them (and current) if is_final
+inline void snapshot_reclaim( snapshot_domain &domain, bool is_final )
+{
+    unsigned long long min_epoch = ~0ULL;
+
+    for( unsigned r=0; r<domain.reader_epoch.size() && !is_final; ++r )
+    {
+        unsigned long long epoch = domain.reader_epoch[r].load();
+
+        if( epoch != 0 )
+            min_epoch = std::min( min_epoch, epoch );
+    }
+
+    unsigned kept = 0;
+
+    for( unsigned i=0; i<domain.retired.size(); ++i )
+    {
+        if( domain.retired[i]->retire_epoch < min_epoch )
+            snapshot_free( domain.retired[i] );
+        else
+            domain.retired[kept++] = domain.retired[i];
+    }
+
+    domain.retired.resize( kept );
+
+    if( is_final && domain.current.load() != NULL )
+        snapshot_free( domain.current.exchange( NULL ) );
+
+    return;
+}
+
+// lock-free: announce the epoch, then load the latest snapshot
+inline const tree_snapshot *snapshot_acquire( snapshot_domain &domain, unsigned reader_id )
+{
+    domain.reader_epoch[reader_id].store( domain.global_epoch.load() );
+    return domain.current.load();
+}
+
+inline void snapshot_release( snapshot_domain &domain, unsigned reader_id )
+{
+    domain.reader_epoch[reader_id].store( 0 );
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*************************************************************************************
+
+  Input: stream of commands "I l r" (insert [l, r]) or "D l r" (delete [l, r]),
+         l and r are arbitrary reals, no interval has to be known in advance
+  Output: length of the union of the current set of intervals after each command
+  Time complexity: O(k*logm), where k is # of commands, m is # of live (distinct) intervals
+                   Tree update after each insertion or deletion -> O(logm) expected,
+                   independent of the intervals seen before
+  Space complexity: O(m)
+  Method used: Dynamic segment tree over the double domain (dynamic_segment_tree.h)
+               The elementary segments between the live endpoints are kept in a
+               balanced tree (treap) of the endpoints, so a new endpoint splits a
+               segment in O(logm) and the endpoint of a deleted interval goes back
+               to the pool
+
+ ************************************************************************************/
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "dynamic_segment_tree.h"
+
+#define NDEBUG
+#define PRECISION 0.000001
+
+// --------------- function declaration --------------- //
+
+void report_result( const dynamic_tree &tree );
+
+using std::vector;
+
+// --------------- function definition --------------- //
+
+void report_result( const dynamic_tree &tree )
+{
+    double length = covered_length( tree );
+
+    if( fabs(length) > PRECISION )
+        printf( "%lf\n", length );
+    else
+        printf( "0.000000\n" );
+}
+
+// --------------- main function --------------- //
+
+int main( int argc, char **argv )
+{
+    // freopen( "../interval_cases/stream1.in", "r", stdin );
+
+    dynamic_tree tree;
+
+    // live intervals with their multiplicity
+    std::map< std::pair<double, double>, unsigned > interval_count;
+
+    char   instruction[4]; // 'D' or 'I'
+    double left_x, right_x;
+
+    while( scanf( "%3s %lf %lf", instruction, &left_x, &right_x ) == 3 )
+    {
+        bool is_zeroLength = !( right_x-left_x >= PRECISION );
+        std::pair<double, double> target( left_x == 0.0 ? 0.0 : left_x, right_x == 0.0 ? 0.0 : right_x ); // -0.0 is 0.0
+
+        if( instruction[0] == 'I' )
+        {
+            unsigned &count = interval_count[target];
+
+            if( count == 0 && !is_zeroLength )
+                interval_insertion( left_x, right_x, tree );
+
+            count++;
+            report_result( tree );
+        }
+        else
+        {
+            assert( instruction[0] == 'D' );
+
+            std::map< std::pair<double, double>, unsigned >::iterator it = interval_count.find( target );
+
+            if( it == interval_count.end() )
+            {
+                printf( "[%lf, %lf] not inserted yet\n", left_x, right_x );
+                continue;
+            }
+
+            if( it->second == 1 )
+            {
+                if( !is_zeroLength )
+                    interval_deletion( left_x, right_x, tree );
+
+                interval_count.erase( it );
+            }
+            else
+                (it->second)--;
+
+            report_result( tree );
+        }
+    }
+
+    return 0;
+}
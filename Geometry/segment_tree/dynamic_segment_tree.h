@@ -0,0 +1,377 @@
+/*************************************************************************************
+
+  Header-only dynamic segment tree over the double domain, shared by
+  dynamic_segment_tree.cpp, replay_segment_tree.cpp and
+  area_iso-oriented_rect/online_area_rec.h
+
+  The elementary segments are the gaps between consecutive live endpoints, kept as
+  a randomized balanced tree (treap) over the distinct live endpoint values; an
+  endpoint x carries delta = # of intervals starting at x minus # ending at x, so
+  the coverage of the segment right of x is the sum of delta up to x. Every node
+  also keeps for the endpoints of its subtree the total delta, the least coverage
+  of the segments between them and their length at that coverage; as coverage is
+  never negative, the union length is the span of all endpoints minus the length
+  at coverage 0. Nodes only exist for live endpoints and go back to the pool when
+  their last interval is deleted
+  Time complexity: insertion/deletion O(logm), window query O(logm), union length
+                   O(1), where m is # of distinct live endpoints (expected)
+  Space complexity: O(m)
+
+ ************************************************************************************/
+
+#ifndef DYNAMIC_SEGMENT_TREE_H
+#define DYNAMIC_SEGMENT_TREE_H
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <vector>
+
+// --------------- class definition --------------- //
+
+// aggregate of a run of consecutive endpoints low_x = x_1 < ... < x_k = high_x (k=0 if empty),
+// covering the k-1 segments between them; the coverage of [x_j, x_j+1) is the delta sum of x_1..x_j
+class endpoint_summary
+{
+    public:
+        endpoint_summary(void) { endpoint_no = 0; delta_sum = 0; min_cover = INT_MAX; min_length = 0.0; low_x = 0.0; high_x = 0.0; }
+
+        unsigned endpoint_no;
+        int      delta_sum;
+        int      min_cover;  // least coverage of the segments, INT_MAX if there are none
+        double   min_length; // length of the segments at min_cover
+        double   low_x, high_x;
+};
+
+// tree node of the dynamic segment tree, one per distinct live endpoint
+class dynamic_node
+{
+    public:
+        dynamic_node(void) { leftChild_id = 0; rightChild_id = 0; priority = 0; x = 0.0; delta = 0; ref_count = 0; }
+
+        unsigned leftChild_id, rightChild_id; // 0 if none
+        unsigned priority;  // heap order of the treap, larger on top
+        double   x;
+        int      delta;     // # of intervals starting at x minus # ending at x
+        unsigned ref_count; // # of interval endpoints at x, the node is released at 0
+        endpoint_summary subtree;
+};
+
+// node pool, node 0 is the null node
+class dynamic_tree
+{
+    public:
+        dynamic_tree(void) { pool.resize(1); root_id = 0; seed = 2463534242u; }
+
+        std::vector<dynamic_node> pool;
+        std::vector<unsigned>     free_id; // recycled node ids
+        unsigned                  root_id;
+        unsigned                  seed;    // xorshift state of the priorities
+};
+
+// --------------- function declaration --------------- //
+
+endpoint_summary summary_merge( const endpoint_summary &left, const endpoint_summary &right );
+
+endpoint_summary summary_single( const dynamic_node &cur );
+
+unsigned node_new( dynamic_tree &tree, double x );
+
+void node_free( dynamic_tree &tree, unsigned cur_id );
+
+void node_pull( dynamic_tree &tree, unsigned cur_id );
+
+unsigned node_remove( dynamic_tree &tree, unsigned cur_id );
+
+unsigned endpoint_update( dynamic_tree &tree, unsigned cur_id, double x, int delta, bool is_insertion );
+
+void interval_insertion( double left_x, double right_x, dynamic_tree &tree );
+
+void interval_deletion( double left_x, double right_x, dynamic_tree &tree );
+
+double summary_length( const endpoint_summary &summary, int cover_base );
+
+double covered_length( const dynamic_tree &tree );
+
+int prefix_delta( const dynamic_tree &tree, double x );
+
+endpoint_summary range_summary( const dynamic_tree &tree, unsigned cur_id, double low_x, double high_x );
+
+double range_length( const dynamic_tree &tree, double low_x, double high_x );
+
+// --------------- function definition --------------- //
+
+// summary of the endpoints of left followed by those of right, all of left lie below right
+inline endpoint_summary summary_merge( const endpoint_summary &left, const endpoint_summary &right )
+{
+    if( left.endpoint_no == 0 )
+        return right;
+
+    if( right.endpoint_no == 0 )
+        return left;
+
+    endpoint_summary merged;
+    merged.endpoint_no = left.endpoint_no + right.endpoint_no;
+    merged.delta_sum   = left.delta_sum + right.delta_sum;
+    merged.low_x       = left.low_x;
+    merged.high_x      = right.high_x;
+
+    // the segments of left, the gap [left.high_x, right.low_x) and the segments of right
+    int    cover[3]  = { left.min_cover, left.delta_sum, (right.min_cover == INT_MAX) ? INT_MAX : left.delta_sum + right.min_cover };
+    double length[3] = { left.min_length, right.low_x - left.high_x, right.min_length };
+
+    merged.min_cover  = std::min( cover[0], std::min( cover[1], cover[2] ) );
+    merged.min_length = 0.0;
+
+    for( unsigned i=0; i<3; ++i )
+    {
+        if( cover[i] == merged.min_cover )
+            merged.min_length += length[i];
+    }
+
+    return merged;
+}
+
+inline endpoint_summary summary_single( const dynamic_node &cur )
+{
+    endpoint_summary single;
+    single.endpoint_no = 1;
+    single.delta_sum   = cur.delta;
+    single.low_x       = cur.x;
+    single.high_x      = cur.x;
+
+    return single;
+}
+
+inline unsigned node_new( dynamic_tree &tree, double x )
+{
+    unsigned cur_id;
+
+    if( !tree.free_id.empty() )
+    {
+        cur_id = tree.free_id.back();
+        tree.free_id.pop_back();
+        tree.pool[cur_id] = dynamic_node();
+    }
+    else
+    {
+        tree.pool.push_back( dynamic_node() );
+        cur_id = tree.pool.size()-1;
+    }
+
+    tree.seed ^= tree.seed << 13;
+    tree.seed ^= tree.seed >> 17;
+    tree.seed ^= tree.seed << 5;
+
+    tree.pool[cur_id].priority = tree.seed;
+    tree.pool[cur_id].x        = x;
+
+    return cur_id;
+}
+
+inline void node_free( dynamic_tree &tree, unsigned cur_id )
+{
+    tree.free_id.push_back( cur_id );
+}
+
+// recompute the summary of the node from its children
+inline void node_pull( dynamic_tree &tree, unsigned cur_id )
+{
+    dynamic_node &cur = tree.pool[cur_id];
+
+    cur.subtree = summary_merge( summary_merge( tree.pool[cur.leftChild_id].subtree, summary_single( cur ) ),
+                                 tree.pool[cur.rightChild_id].subtree );
+}
+
+// rotate the node down until it has at most one child, then splice it out; returns the id of
+// the node taking its place
+inline unsigned node_remove( dynamic_tree &tree, unsigned cur_id )
+{
+    dynamic_node &cur = tree.pool[cur_id]; // the pool does not grow during removal
+    unsigned left_id = cur.leftChild_id, right_id = cur.rightChild_id;
+
+    if( left_id == 0 || right_id == 0 )
+    {
+        node_free( tree, cur_id );
+        return left_id + right_id;
+    }
+
+    if( tree.pool[left_id].priority > tree.pool[right_id].priority ) // rotate right
+    {
+        cur.leftChild_id = tree.pool[left_id].rightChild_id;
+        tree.pool[left_id].rightChild_id = node_remove( tree, cur_id );
+        node_pull( tree, left_id );
+
+        return left_id;
+    }
+    else
+    {
+        cur.rightChild_id = tree.pool[right_id].leftChild_id;
+        tree.pool[right_id].leftChild_id = node_remove( tree, cur_id );
+        node_pull( tree, right_id );
+
+        return right_id;
+    }
+}
+
+// add delta at endpoint x below the node, creating (is_insertion) or releasing the node of x;
+// returns the id of the node taking the place of cur_id after the rotations
+inline unsigned endpoint_update( dynamic_tree &tree, unsigned cur_id, double x, int delta, bool is_insertion )
+{
+    if( cur_id == 0 )
+    {
+        assert( is_insertion );
+        cur_id = node_new( tree, x );
+        tree.pool[cur_id].delta     = delta;
+        tree.pool[cur_id].ref_count = 1;
+        node_pull( tree, cur_id );
+
+        return cur_id;
+    }
+
+    if( x < tree.pool[cur_id].x )
+    {
+        unsigned child_id = endpoint_update( tree, tree.pool[cur_id].leftChild_id, x, delta, is_insertion ); // may move the pool
+        dynamic_node &cur = tree.pool[cur_id];
+        cur.leftChild_id = child_id;
+
+        if( child_id != 0 && tree.pool[child_id].priority > cur.priority ) // rotate right
+        {
+            cur.leftChild_id = tree.pool[child_id].rightChild_id;
+            tree.pool[child_id].rightChild_id = cur_id;
+            node_pull( tree, cur_id );
+            node_pull( tree, child_id );
+
+            return child_id;
+        }
+    }
+    else if( x > tree.pool[cur_id].x )
+    {
+        unsigned child_id = endpoint_update( tree, tree.pool[cur_id].rightChild_id, x, delta, is_insertion );
+        dynamic_node &cur = tree.pool[cur_id];
+        cur.rightChild_id = child_id;
+
+        if( child_id != 0 && tree.pool[child_id].priority > cur.priority ) // rotate left
+        {
+            cur.rightChild_id = tree.pool[child_id].leftChild_id;
+            tree.pool[child_id].leftChild_id = cur_id;
+            node_pull( tree, cur_id );
+            node_pull( tree, child_id );
+
+            return child_id;
+        }
+    }
+    else
+    {
+        dynamic_node &cur = tree.pool[cur_id];
+        cur.delta += delta;
+
+        if( is_insertion )
+            (cur.ref_count)++;
+        else if( --(cur.ref_count) == 0 )
+        {
+            assert( cur.delta == 0 );
+            return node_remove( tree, cur_id );
+        }
+    }
+
+    node_pull( tree, cur_id );
+
+    return cur_id;
+}
+
+// insert [left_x, right_x), right_x > left_x
+inline void interval_insertion( double left_x, double right_x, dynamic_tree &tree )
+{
+    tree.root_id = endpoint_update( tree, tree.root_id, left_x, 1, true );
+    tree.root_id = endpoint_update( tree, tree.root_id, right_x, -1, true );
+}
+
+// delete an inserted [left_x, right_x)
+inline void interval_deletion( double left_x, double right_x, dynamic_tree &tree )
+{
+    tree.root_id = endpoint_update( tree, tree.root_id, left_x, -1, false );
+    tree.root_id = endpoint_update( tree, tree.root_id, right_x, 1, false );
+}
+
+// length of the segments of the summary covered at least once, if the coverage left of low_x is cover_base
+inline double summary_length( const endpoint_summary &summary, int cover_base )
+{
+    if( summary.endpoint_no < 2 )
+        return 0.0;
+
+    double length = summary.high_x - summary.low_x;
+
+    if( cover_base + summary.min_cover == 0 )
+        length -= summary.min_length;
+
+    return length;
+}
+
+inline double covered_length( const dynamic_tree &tree )
+{
+    return summary_length( tree.pool[tree.root_id].subtree, 0 );
+}
+
+// coverage right of x, i.e. the delta sum of the endpoints <= x
+inline int prefix_delta( const dynamic_tree &tree, double x )
+{
+    int sum = 0;
+
+    for( unsigned cur_id = tree.root_id; cur_id != 0; )
+    {
+        const dynamic_node &cur = tree.pool[cur_id];
+
+        if( cur.x <= x )
+        {
+            sum += tree.pool[cur.leftChild_id].subtree.delta_sum + cur.delta;
+            cur_id = cur.rightChild_id;
+        }
+        else
+            cur_id = cur.leftChild_id;
+    }
+
+    return sum;
+}
+
+// summary of the endpoints strictly inside (low_x, high_x) below the node, only the nodes on
+// the paths of the two range ends are split, O(logm)
+inline endpoint_summary range_summary( const dynamic_tree &tree, unsigned cur_id, double low_x, double high_x )
+{
+    const dynamic_node &cur = tree.pool[cur_id];
+
+    if( cur_id == 0 || cur.subtree.high_x <= low_x || cur.subtree.low_x >= high_x )
+        return endpoint_summary();
+
+    if( low_x < cur.subtree.low_x && cur.subtree.high_x < high_x )
+        return cur.subtree;
+
+    endpoint_summary summary = range_summary( tree, cur.leftChild_id, low_x, high_x );
+
+    if( low_x < cur.x && cur.x < high_x )
+        summary = summary_merge( summary, summary_single( cur ) );
+
+    return summary_merge( summary, range_summary( tree, cur.rightChild_id, low_x, high_x ) );
+}
+
+// covered length inside [low_x, high_x]
+inline double range_length( const dynamic_tree &tree, double low_x, double high_x )
+{
+    if( high_x <= low_x )
+        return 0.0;
+
+    endpoint_summary bound;
+    bound.endpoint_no = 1;
+    bound.low_x  = low_x;
+    bound.high_x = low_x;
+
+    endpoint_summary inside = summary_merge( bound, range_summary( tree, tree.root_id, low_x, high_x ) );
+
+    bound.low_x  = high_x;
+    bound.high_x = high_x;
+
+    // low_x stands for the endpoints <= low_x, the coverage of [low_x, next endpoint) is their delta sum
+    return summary_length( summary_merge( inside, bound ), prefix_delta( tree, low_x ) );
+}
+
+#endif
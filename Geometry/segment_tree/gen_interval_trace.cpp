@@ -0,0 +1,192 @@
+/*************************************************************************************
+
+  Input: (command line) interval mix, n intervals, k commands, random seed
+  Output: trace in the input format of segment_tree.cpp: n, the n intervals, then k
+          commands I<n> or D<n>
+  Interval mixes:
+    uniform   - left endpoint and length uniform over the domain
+    nested    - groups of 32 intervals nested around a common center
+    overlap   - every interval contains the middle of the domain
+    duplicate - drawn from n/16 distinct intervals, so most of them appear many times
+    zero      - half of the intervals have zero length
+    mixed     - each interval drawn from one of the mixes above
+  Commands: an interval not inserted is inserted (rarely deleted, which the tools report
+            as not inserted), an inserted one is deleted or inserted once more
+  Method used: 64-bit linear congruential generator, the same trace for the same seed on
+               every platform; endpoints are multiples of 0.001, far above PRECISION
+
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define DOMAIN_SIZE 1000000000ULL // domain [0, 1e6) in units of 0.001
+#define NEST_GROUP  32
+
+// --------------- class definition --------------- //
+
+// interval in units of 0.001
+class trace_interval
+{
+    public:
+        void init( unsigned long long l, unsigned long long r ) { left = l; right = r; }
+
+        unsigned long long left, right;
+};
+
+// --------------- function declaration --------------- //
+
+unsigned long long next_random( unsigned long long &state );
+
+void gen_uniform( trace_interval &target, unsigned long long &state );
+
+void gen_nested( trace_interval &target, unsigned id, std::vector<trace_interval> &nest_center, unsigned long long &state );
+
+void gen_overlap( trace_interval &target, unsigned long long &state );
+
+void gen_zero( trace_interval &target, unsigned long long &state );
+
+using std::vector;
+
+// --------------- function definition --------------- //
+
+inline unsigned long long next_random( unsigned long long &state )
+{
+    state = state*6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 17;
+}
+
+// length up to 1% of the domain
+void gen_uniform( trace_interval &target, unsigned long long &state )
+{
+    unsigned long long left = next_random( state ) % DOMAIN_SIZE;
+    unsigned long long length = 1 + next_random( state ) % (DOMAIN_SIZE/100);
+
+    target.init( left, std::min( left+length, DOMAIN_SIZE ) );
+}
+
+// the j-th interval of a group is 1/NEST_GROUP narrower than the (j-1)-th on each side
+void gen_nested( trace_interval &target, unsigned id, vector<trace_interval> &nest_center, unsigned long long &state )
+{
+    unsigned group = id / NEST_GROUP, j = id % NEST_GROUP;
+
+    if( group >= nest_center.size() )
+    {
+        unsigned long long half  = NEST_GROUP + next_random( state ) % (DOMAIN_SIZE/20);
+        unsigned long long center = half + next_random( state ) % (DOMAIN_SIZE-2*half);
+        trace_interval outer;
+        outer.init( center-half, center+half );
+        nest_center.push_back( outer );
+    }
+
+    const trace_interval &outer = nest_center[group];
+    unsigned long long half = (outer.right-outer.left)/2;
+    unsigned long long shrink = half * j / NEST_GROUP;
+
+    target.init( outer.left+shrink, outer.right-shrink );
+}
+
+// left in the first 40% of the domain, right in the last 40%
+void gen_overlap( trace_interval &target, unsigned long long &state )
+{
+    unsigned long long left  = next_random( state ) % (DOMAIN_SIZE/10*4);
+    unsigned long long right = DOMAIN_SIZE/10*6 + next_random( state ) % (DOMAIN_SIZE/10*4);
+
+    target.init( left, right );
+}
+
+void gen_zero( trace_interval &target, unsigned long long &state )
+{
+    if( next_random( state ) & 1 )
+    {
+        unsigned long long x = next_random( state ) % DOMAIN_SIZE;
+        target.init( x, x );
+    }
+    else
+        gen_uniform( target, state );
+}
+
+// --------------- main function --------------- //
+
+// usage: gen_interval_trace <uniform|nested|overlap|duplicate|zero|mixed> n k [seed]
+int main( int argc, char **argv )
+{
+    static const char *mix_name[] = { "uniform", "nested", "overlap", "duplicate", "zero", "mixed" };
+    const unsigned mix_no = sizeof(mix_name)/sizeof(mix_name[0]);
+
+    unsigned mix = mix_no;
+
+    for( unsigned m=0; argc >= 4 && m<mix_no; ++m )
+    {
+        if( strcmp( argv[1], mix_name[m] ) == 0 )
+            mix = m;
+    }
+
+    if( mix == mix_no )
+    {
+        fprintf( stderr, "usage: %s <uniform|nested|overlap|duplicate|zero|mixed> n k [seed]\n", argv[0] );
+        return 1;
+    }
+
+    unsigned interval_no = static_cast<unsigned>(atoi( argv[2] ));
+    unsigned command_no  = static_cast<unsigned>(atoi( argv[3] ));
+    unsigned long long state = (argc > 4) ? static_cast<unsigned long long>(atoll( argv[4] )) : 1;
+
+    if( interval_no == 0 )
+        interval_no = 1;
+
+    vector<trace_interval> interval_set( interval_no+1 ); // (use +1 offset)
+    vector<trace_interval> nest_center;
+    unsigned distinct_no = interval_no/16 + 1;
+
+    for( unsigned i=1; i<=interval_no; ++i )
+    {
+        unsigned cur_mix = (mix == 5) ? next_random( state ) % 5 : mix;
+
+        switch( cur_mix )
+        {
+            case 0: gen_uniform( interval_set[i], state ); break;
+            case 1: gen_nested( interval_set[i], i-1, nest_center, state ); break;
+            case 2: gen_overlap( interval_set[i], state ); break;
+            case 3: // repeat one of the first distinct_no intervals once they exist
+                if( i > distinct_no )
+                    interval_set[i] = interval_set[1 + next_random( state ) % distinct_no];
+                else
+                    gen_uniform( interval_set[i], state );
+                break;
+            default: gen_zero( interval_set[i], state ); break;
+        }
+    }
+
+    printf( "%u\n", interval_no );
+
+    for( unsigned i=1; i<=interval_no; ++i )
+        printf( "%llu.%03llu %llu.%03llu\n", interval_set[i].left/1000, interval_set[i].left%1000,
+                interval_set[i].right/1000, interval_set[i].right%1000 );
+
+    vector<unsigned> interval_count( interval_no+1, 0 ); // (use +1 offset)
+
+    for( unsigned i=0; i<command_no; ++i )
+    {
+        unsigned target_id = 1 + next_random( state ) % interval_no;
+        unsigned dice = next_random( state ) % 100;
+        bool     is_insertion;
+
+        if( interval_count[target_id] == 0 )
+            is_insertion = ( dice >= 2 );
+        else
+            is_insertion = ( dice < 40 );
+
+        if( is_insertion )
+            interval_count[target_id]++;
+        else if( interval_count[target_id] > 0 )
+            interval_count[target_id]--;
+
+        printf( "%c%u\n", is_insertion ? 'I' : 'D', target_id );
+    }
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*************************************************************************************
+
+  Input: set of n (horizontal) intervals, k commands doing insertion or deletion
+         (I<n>, D<n>) or asking about an earlier version: "H t" for the union length
+         and "W t a b" for the covered length inside window [a, b] right after the t-th
+         insertion/deletion command (t=0 is the empty set)
+  Output: length of the union after each insertion or deletion, answer of each query
+  Time complexity: O(n*logn+k*logn), where n is # of intervals, k is # of commands
+                   Sorting of endpoints -> O(n*logn)
+                   Tree update after each insertion or deletion -> O(logn) new nodes
+                   Query of any version -> O(logn)
+  Space complexity: O(n+k*logn)
+  Method used: Persistent segment tree (path copying, persistent_segment_tree.h)
+               An update copies the nodes on its root-to-canonical-node paths into a node
+               pool instead of overwriting them, the root of every version is kept
+
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "segment_tree.h"
+#include "persistent_segment_tree.h"
+
+#define NDEBUG
+#define PRECISION 0.000001
+
+// --------------- function declaration --------------- //
+
+void report_result( double length );
+
+using std::vector;
+
+// --------------- function definition --------------- //
+
+void report_result( double length )
+{
+    if( fabs(length) > PRECISION )
+        printf( "%lf\n", length );
+    else
+        printf( "0.000000\n" );
+}
+
+// --------------- main function --------------- //
+
+int main( int argc, char **argv )
+{
+    // freopen( "../interval_cases/case1.in", "r", stdin );
+
+    unsigned interval_no;
+
+    scanf( "%u", &interval_no );
+
+    vector< interval<double> > interval_set; // all intervals (use +1 offset)
+    interval_set.resize( interval_no+1 );
+
+    vector< endpoint<double> > endpoint_set; // all endpoints (use no offset)
+    endpoint_set.resize( interval_no*2 );
+
+    { // parse input intervals
+        unsigned e_id = 0;
+        interval_no+=1;
+
+        for( unsigned i=1; i<interval_no; ++i )
+        {
+            scanf( "%lf", &(interval_set[i].rLeft_x) );
+            scanf( "%lf", &(interval_set[i].rRight_x) );
+            interval_set[i].rLength = interval_set[i].rRight_x - interval_set[i].rLeft_x;
+            assert( interval_set[i].rLength >= 0.0 );
+
+            if( fabs( interval_set[i].rLength ) < PRECISION )
+                interval_set[i].is_zeroLength = true;
+
+            endpoint_set[e_id++].init( interval_set[i].rLeft_x, i, true );
+            endpoint_set[e_id++].init( interval_set[i].rRight_x, i, false );
+        }
+
+        assert( e_id == endpoint_set.size() );
+        interval_no-=1; // recover
+    }
+
+    vector<double> map_to_real; // mapped space to real value, (use +1 offset)
+
+    // map the real space to integer space counting from integer 1
+    unsigned global_max_x = compress_endpoints( endpoint_set, interval_set, map_to_real ); // max x of the mapped space, min x is 1
+
+    vector<persistent_node> node_pool( 1 );        // node 0 is the empty node, every version shares it
+    vector<unsigned>        version_root( 1, 0 ); // root of the tree after the t-th insertion/deletion
+
+    vector<unsigned> interval_count; // record the interval count being inserted (use +1 offset)
+    interval_count.resize( interval_no+1, 0 );
+
+    { // read the remainder input command to do insertion, deletion or history query
+        char instruction;   // 'D', 'I', 'H' or 'W'
+        char command[20];   // ex. D3 - delete interval 3
+        unsigned target_id; // target interval id
+        unsigned root_id;
+
+        while( scanf( "%s", command ) != EOF )
+        {
+            instruction = command[0];
+
+            if( instruction == 'H' || instruction == 'W' )
+            {
+                unsigned version;
+                double   window_left  = map_to_real[1];
+                double   window_right = map_to_real[global_max_x];
+
+                if( scanf( "%u", &version ) != 1 )
+                    break;
+
+                if( instruction == 'W' && scanf( "%lf %lf", &window_left, &window_right ) != 2 )
+                    break;
+
+                if( version >= version_root.size() )
+                {
+                    printf( "version %u not created yet\n", version );
+                    continue;
+                }
+
+                root_id = version_root[version];
+
+                if( instruction == 'H' )
+                    report_result( covered_length( node_pool, root_id, 1, global_max_x, map_to_real ) );
+                else
+                    report_result( window_length( node_pool, root_id, 1, global_max_x, window_left, window_right, map_to_real ) );
+
+                continue;
+            }
+
+            command[0] = '0';
+            target_id = static_cast<unsigned>(atoi(command));
+            root_id = version_root.back();
+
+            if( instruction == 'I' )
+            {
+                if( (interval_count[target_id]==0) && !(interval_set[target_id].is_zeroLength) )
+                    root_id = interval_update( interval_set[target_id].left_x, interval_set[target_id].right_x, 1,
+                                               root_id, 1, global_max_x, node_pool, map_to_real );
+
+                interval_count[target_id]++;
+            }
+            else
+            {
+                assert( instruction == 'D' );
+
+                if( interval_count[target_id]==0 )
+                {
+                    printf( "S%u not inserted yet\n", target_id );
+                    version_root.push_back( root_id ); // the command still makes a version
+                    continue;
+                }
+
+                if( (interval_count[target_id]==1) && !(interval_set[target_id].is_zeroLength) )
+                    root_id = interval_update( interval_set[target_id].left_x, interval_set[target_id].right_x, -1,
+                                               root_id, 1, global_max_x, node_pool, map_to_real );
+
+                interval_count[target_id]--;
+            }
+
+            version_root.push_back( root_id );
+            report_result( covered_length( node_pool, root_id, 1, global_max_x, map_to_real ) );
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*************************************************************************************
+
+  Header-only persistent segment tree (path copying), shared by
+  persistent_segment_tree.cpp and replay_segment_tree.cpp
+
+  An update copies the nodes on its root-to-canonical-node paths into a node pool
+  instead of overwriting them and returns the root of the new version, every earlier
+  root stays valid; node 0 is the shared empty node
+  Time complexity: update O(logn) new nodes, query of any version O(logn)
+
+ ************************************************************************************/
+
+#ifndef PERSISTENT_SEGMENT_TREE_H
+#define PERSISTENT_SEGMENT_TREE_H
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+// --------------- class definition --------------- //
+
+// tree node of the persistent segment tree, never modified once a version is published
+// the mapped range of a node is implied by its path, node 0 is the shared empty node
+class persistent_node
+{
+    public:
+        persistent_node(void) { leftChild_id = 0; rightChild_id = 0; intervalCount = 0; subtreeRLength = 0.0; }
+
+        unsigned leftChild_id, rightChild_id;
+        unsigned intervalCount;
+        double   subtreeRLength; // interval length of the subtree
+};
+
+// --------------- function declaration --------------- //
+
+double covered_length( const std::vector<persistent_node> &node_pool, unsigned cur_id, unsigned left_x, unsigned right_x,
+                       const std::vector<double> &map_to_real );
+
+unsigned interval_update( unsigned target_left_x, unsigned target_right_x, int delta, unsigned cur_id,
+                          unsigned left_x, unsigned right_x, std::vector<persistent_node> &node_pool, const std::vector<double> &map_to_real );
+
+double window_length( const std::vector<persistent_node> &node_pool, unsigned cur_id, unsigned left_x, unsigned right_x,
+                      double window_left, double window_right, const std::vector<double> &map_to_real );
+
+// --------------- function definition --------------- //
+
+// union length of the intervals stored at or below the node spanning [left_x, right_x]
+inline double covered_length( const std::vector<persistent_node> &node_pool, unsigned cur_id, unsigned left_x, unsigned right_x,
+                              const std::vector<double> &map_to_real )
+{
+    if( node_pool[cur_id].intervalCount > 0 )
+        return map_to_real[right_x] - map_to_real[left_x];
+    else
+        return node_pool[cur_id].subtreeRLength;
+}
+
+// add delta (+1 insertion, -1 deletion) to the canonical nodes of [target_left_x, target_right_x]
+// below the node spanning [left_x, right_x], returns the id of the copy replacing the node
+inline unsigned interval_update( unsigned target_left_x, unsigned target_right_x, int delta, unsigned cur_id,
+                                 unsigned left_x, unsigned right_x, std::vector<persistent_node> &node_pool, const std::vector<double> &map_to_real )
+{
+    persistent_node copy = node_pool[cur_id];
+
+    if( (target_left_x <= left_x) && (target_right_x >= right_x) )
+    {
+        assert( delta > 0 || copy.intervalCount > 0 );
+        copy.intervalCount += delta;
+    }
+    else
+    {
+        unsigned key = (left_x + right_x)/2;
+
+        if( target_left_x < key )
+            copy.leftChild_id = interval_update( target_left_x, target_right_x, delta, copy.leftChild_id, left_x, key, node_pool, map_to_real );
+
+        if( target_right_x > key )
+            copy.rightChild_id = interval_update( target_left_x, target_right_x, delta, copy.rightChild_id, key, right_x, node_pool, map_to_real );
+
+        copy.subtreeRLength = covered_length( node_pool, copy.leftChild_id, left_x, key, map_to_real )
+                            + covered_length( node_pool, copy.rightChild_id, key, right_x, map_to_real );
+    }
+
+    node_pool.push_back( copy );
+
+    return node_pool.size()-1;
+}
+
+// covered length inside [window_left, window_right] below the node spanning [left_x, right_x]
+inline double window_length( const std::vector<persistent_node> &node_pool, unsigned cur_id, unsigned left_x, unsigned right_x,
+                             double window_left, double window_right, const std::vector<double> &map_to_real )
+{
+    double overlap = std::min( window_right, map_to_real[right_x] ) - std::max( window_left, map_to_real[left_x] );
+
+    if( cur_id == 0 || overlap <= 0.0 )
+        return 0.0;
+
+    if( node_pool[cur_id].intervalCount > 0 )
+        return overlap;
+
+    if( window_left <= map_to_real[left_x] && map_to_real[right_x] <= window_right )
+        return node_pool[cur_id].subtreeRLength;
+
+    unsigned key = (left_x + right_x)/2;
+
+    return window_length( node_pool, node_pool[cur_id].leftChild_id, left_x, key, window_left, window_right, map_to_real )
+         + window_length( node_pool, node_pool[cur_id].rightChild_id, key, right_x, window_left, window_right, map_to_real );
+}
+
+#endif
@@ -0,0 +1,623 @@
+/*************************************************************************************
+
+  Input: trace in the input format of segment_tree.cpp (see gen_interval_trace.cpp),
+         Q and S queries in it are skipped
+  Output: per backend the construction time, commands/s, latency percentiles of one
+          command (update plus union length), memory of the tree and the result of
+          the cross-check against a brute-force sweep
+  Backends:
+    implicit   - segment_tree.h, union length only
+    depth      - segment_tree.h with the coverage-depth augmentation (k=4)
+    dynamic    - dynamic_segment_tree.h, no endpoint compression, a balanced tree of
+                 the live endpoints
+    persistent - persistent_segment_tree.h, every version root is kept
+    sharded    - concurrent_segment_tree.h, 8 shards updated by the replaying thread
+    snapshot   - concurrent_segment_tree.h, a snapshot is published after every
+                 command and the union length is read from the latest snapshot
+  Method used: every backend replays the trace twice, the first pass is timed as a whole
+               for the throughput, the second one command by command for the latencies;
+               during the second pass the union length is compared with a sort-and-merge
+               sweep over the live intervals every c-th command and after the last one
+
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "segment_tree.h"
+#include "dynamic_segment_tree.h"
+#include "persistent_segment_tree.h"
+#include "concurrent_segment_tree.h"
+
+#define NDEBUG
+#define PRECISION 0.000001
+#define DEPTH_K   4  // coverage depth kept by the depth backend
+#define SHARD_NO  8  // shards of the sharded backend
+
+// --------------- class definition --------------- //
+
+// one I<n> or D<n> command of the trace
+class command
+{
+    public:
+        bool     is_insertion;
+        unsigned target_id;
+};
+
+// the parsed trace, intervals are compressed once for the backends that need it
+class trace
+{
+    public:
+        std::vector< interval<double> > interval_set; // (use +1 offset)
+        std::vector<double>             map_to_real;  // (use +1 offset)
+        unsigned                        global_max_x;
+        std::vector<command>            command_set;
+};
+
+class implicit_backend
+{
+    public:
+        segment_tree<double> tree;
+};
+
+class depth_backend
+{
+    public:
+        segment_tree< double, depth_augment<double> > tree;
+};
+
+class dynamic_backend
+{
+    public:
+        dynamic_tree tree;
+};
+
+class persistent_backend
+{
+    public:
+        std::vector<persistent_node> node_pool;    // node 0 is the empty node
+        std::vector<unsigned>        version_root; // root after the t-th command changing the tree
+        unsigned                     global_max_x;
+        const std::vector<double>   *map_to_real;
+};
+
+// not copyable, the shards hold their locks
+class sharded_backend
+{
+    public:
+        sharded_backend(void) : forest( SHARD_NO ) {}
+
+        sharded_tree forest;
+};
+
+// the snapshots are freed with the backend
+class snapshot_backend
+{
+    public:
+        snapshot_backend(void) : domain( 0 ) {}
+        ~snapshot_backend(void) { snapshot_reclaim( domain, true ); }
+
+        segment_tree<double> tree;
+        snapshot_domain      domain;
+};
+
+// --------------- function declaration --------------- //
+
+void read_trace( trace &input );
+
+void backend_construct( implicit_backend &backend, const trace &input );
+
+void backend_construct( depth_backend &backend, const trace &input );
+
+void backend_construct( dynamic_backend &backend, const trace &input );
+
+void backend_construct( persistent_backend &backend, const trace &input );
+
+void backend_construct( sharded_backend &backend, const trace &input );
+
+void backend_construct( snapshot_backend &backend, const trace &input );
+
+void backend_update( implicit_backend &backend, const interval<double> &target, bool is_insertion );
+
+void backend_update( depth_backend &backend, const interval<double> &target, bool is_insertion );
+
+void backend_update( dynamic_backend &backend, const interval<double> &target, bool is_insertion );
+
+void backend_update( persistent_backend &backend, const interval<double> &target, bool is_insertion );
+
+void backend_update( sharded_backend &backend, const interval<double> &target, bool is_insertion );
+
+void backend_update( snapshot_backend &backend, const interval<double> &target, bool is_insertion );
+
+double backend_length( const implicit_backend &backend );
+
+double backend_length( const depth_backend &backend );
+
+double backend_length( const dynamic_backend &backend );
+
+double backend_length( const persistent_backend &backend );
+
+double backend_length( sharded_backend &backend );
+
+double backend_length( const snapshot_backend &backend );
+
+size_t backend_memory( const implicit_backend &backend );
+
+size_t backend_memory( const depth_backend &backend );
+
+size_t backend_memory( const dynamic_backend &backend );
+
+size_t backend_memory( const persistent_backend &backend );
+
+size_t backend_memory( const sharded_backend &backend );
+
+size_t backend_memory( const snapshot_backend &backend );
+
+size_t page_memory( const block_page *page, unsigned level );
+
+template <class backend_type>
+double replay_command( backend_type &backend, const trace &input, const command &cmd, std::vector<unsigned> &interval_count );
+
+double sweep_length( const trace &input, const std::vector<unsigned> &interval_count );
+
+template <class backend_type>
+bool replay_process( const char *name, const trace &input, unsigned check_every );
+
+using std::vector;
+
+// --------------- function definition --------------- //
+
+void read_trace( trace &input )
+{
+    unsigned interval_no = 0;
+
+    if( scanf( "%u", &interval_no ) != 1 )
+        interval_no = 0;
+
+    input.interval_set.resize( interval_no+1 );
+    vector< endpoint<double> > endpoint_set( interval_no*2 ); // (use no offset)
+
+    for( unsigned i=1, e_id=0; i<=interval_no; ++i )
+    {
+        interval<double> &target = input.interval_set[i];
+
+        if( scanf( "%lf %lf", &(target.rLeft_x), &(target.rRight_x) ) != 2 )
+            target.rLeft_x = target.rRight_x = 0.0;
+
+        target.rLength = target.rRight_x - target.rLeft_x;
+        assert( target.rLength >= 0.0 );
+
+        if( fabs( target.rLength ) < PRECISION )
+            target.is_zeroLength = true;
+
+        endpoint_set[e_id++].init( target.rLeft_x, i, true );
+        endpoint_set[e_id++].init( target.rRight_x, i, false );
+    }
+
+    input.global_max_x = compress_endpoints( endpoint_set, input.interval_set, input.map_to_real );
+
+    char   buffer[20]; // ex. D3 - delete interval 3
+    double arg;
+
+    while( scanf( "%19s", buffer ) == 1 )
+    {
+        if( buffer[0] == 'Q' || buffer[0] == 'S' ) // skip the arguments of queries
+        {
+            for( int i = (buffer[0] == 'Q') ? 2 : 1; i > 0; --i )
+            {
+                if( scanf( "%lf", &arg ) != 1 )
+                    break;
+            }
+
+            continue;
+        }
+
+        command cmd;
+        cmd.is_insertion = ( buffer[0] == 'I' );
+        cmd.target_id    = static_cast<unsigned>(atoi( buffer+1 ));
+
+        if( (buffer[0] == 'I' || buffer[0] == 'D') && cmd.target_id > 0 && cmd.target_id <= interval_no )
+            input.command_set.push_back( cmd );
+    }
+
+    return;
+}
+
+void backend_construct( implicit_backend &backend, const trace &input )
+{
+    tree_construct( backend.tree, input.map_to_real, input.global_max_x );
+}
+
+void backend_construct( depth_backend &backend, const trace &input )
+{
+    backend.tree.augment.coverage_k = DEPTH_K;
+    tree_construct( backend.tree, input.map_to_real, input.global_max_x );
+}
+
+void backend_construct( dynamic_backend &backend, const trace & )
+{
+    backend.tree = dynamic_tree();
+}
+
+void backend_construct( persistent_backend &backend, const trace &input )
+{
+    backend.node_pool.assign( 1, persistent_node() );
+    backend.version_root.assign( 1, 0 );
+    backend.global_max_x = input.global_max_x;
+    backend.map_to_real  = &(input.map_to_real);
+}
+
+void backend_construct( sharded_backend &backend, const trace &input )
+{
+    sharded_construct( backend.forest, input.map_to_real, input.global_max_x );
+}
+
+void backend_construct( snapshot_backend &backend, const trace &input )
+{
+    tree_construct( backend.tree, input.map_to_real, input.global_max_x );
+    snapshot_publish( backend.tree, backend.domain );
+}
+
+inline void backend_update( implicit_backend &backend, const interval<double> &target, bool is_insertion )
+{
+    if( is_insertion )
+        interval_insertion( target.left_x, target.right_x, backend.tree );
+    else
+        interval_deletion( target.left_x, target.right_x, backend.tree );
+}
+
+inline void backend_update( depth_backend &backend, const interval<double> &target, bool is_insertion )
+{
+    if( is_insertion )
+        interval_insertion( target.left_x, target.right_x, backend.tree );
+    else
+        interval_deletion( target.left_x, target.right_x, backend.tree );
+}
+
+inline void backend_update( dynamic_backend &backend, const interval<double> &target, bool is_insertion )
+{
+    if( is_insertion )
+        interval_insertion( target.rLeft_x, target.rRight_x, backend.tree );
+    else
+        interval_deletion( target.rLeft_x, target.rRight_x, backend.tree );
+}
+
+inline void backend_update( persistent_backend &backend, const interval<double> &target, bool is_insertion )
+{
+    backend.version_root.push_back( interval_update( target.left_x, target.right_x, is_insertion ? 1 : -1, backend.version_root.back(),
+                                                     1, backend.global_max_x, backend.node_pool, *(backend.map_to_real) ) );
+}
+
+inline void backend_update( sharded_backend &backend, const interval<double> &target, bool is_insertion )
+{
+    sharded_update( target.left_x, target.right_x, is_insertion, backend.forest );
+}
+
+// publish as the writer of segment_tree.cpp -m does
+inline void backend_update( snapshot_backend &backend, const interval<double> &target, bool is_insertion )
+{
+    if( is_insertion )
+        interval_insertion( target.left_x, target.right_x, backend.tree );
+    else
+        interval_deletion( target.left_x, target.right_x, backend.tree );
+
+    snapshot_mark( target.left_x, target.right_x, backend.tree, backend.domain );
+    snapshot_publish( backend.tree, backend.domain );
+}
+
+inline double backend_length( const implicit_backend &backend )
+{
+    return covered_length( backend.tree, 1 );
+}
+
+inline double backend_length( const depth_backend &backend )
+{
+    return covered_length( backend.tree, 1 );
+}
+
+inline double backend_length( const dynamic_backend &backend )
+{
+    return covered_length( backend.tree );
+}
+
+inline double backend_length( const persistent_backend &backend )
+{
+    return covered_length( backend.node_pool, backend.version_root.back(), 1, backend.global_max_x, *(backend.map_to_real) );
+}
+
+inline double backend_length( sharded_backend &backend )
+{
+    return sharded_length( backend.forest );
+}
+
+// read from the published snapshot, not from the writer's tree
+inline double backend_length( const snapshot_backend &backend )
+{
+    return snapshot_length( *(backend.domain.current.load()) );
+}
+
+size_t backend_memory( const implicit_backend &backend )
+{
+    const segment_tree<double> &tree = backend.tree;
+
+    return tree.intervalCount.capacity()*sizeof(unsigned) + (tree.rLength.capacity()+tree.subtreeRLength.capacity())*sizeof(double);
+}
+
+size_t backend_memory( const depth_backend &backend )
+{
+    const segment_tree< double, depth_augment<double> > &tree = backend.tree;
+
+    return tree.intervalCount.capacity()*sizeof(unsigned) + (tree.rLength.capacity()+tree.subtreeRLength.capacity())*sizeof(double)
+         + tree.augment.kRLength.capacity()*sizeof(double) + tree.augment.maxDepth.capacity()*sizeof(unsigned);
+}
+
+// the pool never shrinks, so its capacity is the peak
+size_t backend_memory( const dynamic_backend &backend )
+{
+    return backend.tree.pool.capacity()*sizeof(dynamic_node) + backend.tree.free_id.capacity()*sizeof(unsigned);
+}
+
+size_t backend_memory( const persistent_backend &backend )
+{
+    return backend.node_pool.capacity()*sizeof(persistent_node) + backend.version_root.capacity()*sizeof(unsigned);
+}
+
+size_t backend_memory( const sharded_backend &backend )
+{
+    size_t memory = 0;
+
+    for( unsigned s=0; s<backend.forest.shard_set.size(); ++s )
+    {
+        const segment_tree<double> &tree = backend.forest.shard_set[s].tree;
+        memory += tree.intervalCount.capacity()*sizeof(unsigned) + (tree.rLength.capacity()+tree.subtreeRLength.capacity())*sizeof(double);
+    }
+
+    return memory;
+}
+
+// the writer's tree and the latest snapshot, the retired ones are freed at once without readers
+size_t backend_memory( const snapshot_backend &backend )
+{
+    const segment_tree<double> &tree = backend.tree;
+    const tree_snapshot *snapshot = backend.domain.current.load();
+
+    return tree.intervalCount.capacity()*sizeof(unsigned) + (tree.rLength.capacity()+tree.subtreeRLength.capacity())*sizeof(double)
+         + sizeof(tree_snapshot) + page_memory( snapshot->root, snapshot->height-1 );
+}
+
+// pages and blocks reachable from the page of the given level
+size_t page_memory( const block_page *page, unsigned level )
+{
+    if( page == NULL )
+        return 0;
+
+    size_t memory = sizeof(block_page);
+
+    for( unsigned c=0; c<(1u << PAGE_BITS); ++c )
+    {
+        if( level > 0 )
+            memory += page_memory( page->child[c], level-1 );
+        else if( page->block[c] != NULL )
+            memory += sizeof(node_block);
+    }
+
+    return memory;
+}
+
+// apply one command as segment_tree.cpp does, returns the union length afterwards
+template <class backend_type>
+inline double replay_command( backend_type &backend, const trace &input, const command &cmd, vector<unsigned> &interval_count )
+{
+    const interval<double> &target = input.interval_set[cmd.target_id];
+    unsigned &count = interval_count[cmd.target_id];
+
+    if( cmd.is_insertion )
+    {
+        if( count == 0 && !(target.is_zeroLength) )
+            backend_update( backend, target, true );
+
+        count++;
+    }
+    else if( count > 0 )
+    {
+        if( count == 1 && !(target.is_zeroLength) )
+            backend_update( backend, target, false );
+
+        count--;
+    }
+
+    return backend_length( backend );
+}
+
+// union length of the live intervals by sorting and merging them
+double sweep_length( const trace &input, const vector<unsigned> &interval_count )
+{
+    vector< std::pair<double, double> > live;
+
+    for( unsigned i=1; i<input.interval_set.size(); ++i )
+    {
+        if( interval_count[i] > 0 && !(input.interval_set[i].is_zeroLength) )
+            live.push_back( std::make_pair( input.interval_set[i].rLeft_x, input.interval_set[i].rRight_x ) );
+    }
+
+    std::sort( live.begin(), live.end() );
+
+    double length = 0.0;
+
+    for( unsigned i=0; i<live.size(); )
+    {
+        double left = live[i].first, right = live[i].second;
+
+        for( ++i; i<live.size() && live[i].first <= right; ++i )
+            right = std::max( right, live[i].second );
+
+        length += right-left;
+    }
+
+    return length;
+}
+
+// replay the trace on one backend and print its report line, false if the cross-check fails
+template <class backend_type>
+bool replay_process( const char *name, const trace &input, unsigned check_every )
+{
+    typedef std::chrono::steady_clock clock_type;
+
+    unsigned command_no = input.command_set.size();
+    vector<unsigned> interval_count;
+    double checksum = 0.0;
+    double build_seconds, run_seconds;
+    size_t memory;
+
+    { // pass 1: throughput
+        backend_type backend;
+        interval_count.assign( input.interval_set.size(), 0 );
+
+        clock_type::time_point start = clock_type::now();
+        backend_construct( backend, input );
+        clock_type::time_point built = clock_type::now();
+
+        for( unsigned i=0; i<command_no; ++i )
+            checksum += replay_command( backend, input, input.command_set[i], interval_count );
+
+        clock_type::time_point done = clock_type::now();
+        build_seconds = std::chrono::duration<double>( built-start ).count();
+        run_seconds   = std::chrono::duration<double>( done-built ).count();
+        memory        = backend_memory( backend );
+    }
+
+    vector<double> latency( command_no );
+    unsigned check_no = 0;
+    double   max_error = 0.0;
+    bool     is_ok = true;
+
+    { // pass 2: latency of every command and cross-check
+        backend_type backend;
+        interval_count.assign( input.interval_set.size(), 0 );
+        backend_construct( backend, input );
+
+        for( unsigned i=0; i<command_no; ++i )
+        {
+            clock_type::time_point start = clock_type::now();
+            double length = replay_command( backend, input, input.command_set[i], interval_count );
+            latency[i] = std::chrono::duration<double>( clock_type::now()-start ).count();
+
+            if( check_every == 0 || ( (i+1)%check_every != 0 && i+1 != command_no ) )
+                continue;
+
+            double expected = sweep_length( input, interval_count );
+            double error    = fabs( length-expected );
+            check_no++;
+            max_error = std::max( max_error, error );
+
+            // endpoints closer than PRECISION are merged by the compression
+            if( error > PRECISION * std::max( 1.0, fabs(expected) ) && is_ok )
+            {
+                fprintf( stderr, "%s: MISMATCH after command %u: tree %lf, sweep %lf\n", name, i+1, length, expected );
+                is_ok = false;
+            }
+        }
+    }
+
+    std::sort( latency.begin(), latency.end() );
+
+    printf( "%-10s build %.3lf ms, %u commands, %.0lf commands/s, memory %.3lf MB\n", name, build_seconds*1e3, command_no,
+            (run_seconds > 0.0) ? command_no/run_seconds : 0.0, memory/1048576.0 );
+
+    if( command_no > 0 )
+        printf( "           latency p50 %.3lf us, p90 %.3lf us, p99 %.3lf us, p99.9 %.3lf us, max %.3lf us\n",
+                latency[command_no/2]*1e6, latency[command_no*9/10]*1e6, latency[command_no*99/100]*1e6,
+                latency[command_no*999/1000]*1e6, latency.back()*1e6 );
+
+    printf( "           check %s, %u points, max error %.3g (checksum %.6lf)\n", is_ok ? "ok" : "FAILED", check_no, max_error, checksum );
+
+    return is_ok;
+}
+
+// --------------- main function --------------- //
+
+// usage: replay_segment_tree [-k implicit|depth|dynamic|persistent|sharded|snapshot|all] [-c every] < trace
+//   -k  backend to replay, all by default
+//   -c  cross-check every c-th command (0: none), by default about 100 checks per trace
+int main( int argc, char **argv )
+{
+    const char *backend_name = "all";
+    int         check_every  = -1;
+
+    for( int i=1; i<argc; ++i )
+    {
+        if( strcmp( argv[i], "-k" ) == 0 && i+1 < argc )
+            backend_name = argv[++i];
+        else if( strcmp( argv[i], "-c" ) == 0 && i+1 < argc )
+            check_every = atoi( argv[++i] );
+        else
+        {
+            fprintf( stderr, "usage: %s [-k implicit|depth|dynamic|persistent|sharded|snapshot|all] [-c every] < trace\n", argv[0] );
+            return 1;
+        }
+    }
+
+    trace input;
+    read_trace( input );
+
+    if( check_every < 0 )
+        check_every = input.command_set.size()/100 + 1;
+
+    printf( "%u intervals, %u elementary segments, %u commands\n", static_cast<unsigned>(input.interval_set.size()-1),
+            (input.global_max_x > 1) ? input.global_max_x-1 : 0, static_cast<unsigned>(input.command_set.size()) );
+
+    bool is_all = ( strcmp( backend_name, "all" ) == 0 );
+    bool is_ok  = true;
+    bool is_run = false;
+
+    if( is_all || strcmp( backend_name, "implicit" ) == 0 )
+    {
+        is_ok  = replay_process<implicit_backend>( "implicit", input, check_every ) && is_ok;
+        is_run = true;
+    }
+
+    if( is_all || strcmp( backend_name, "depth" ) == 0 )
+    {
+        is_ok  = replay_process<depth_backend>( "depth", input, check_every ) && is_ok;
+        is_run = true;
+    }
+
+    if( is_all || strcmp( backend_name, "dynamic" ) == 0 )
+    {
+        is_ok  = replay_process<dynamic_backend>( "dynamic", input, check_every ) && is_ok;
+        is_run = true;
+    }
+
+    if( is_all || strcmp( backend_name, "persistent" ) == 0 )
+    {
+        is_ok  = replay_process<persistent_backend>( "persistent", input, check_every ) && is_ok;
+        is_run = true;
+    }
+
+    if( is_all || strcmp( backend_name, "sharded" ) == 0 )
+    {
+        is_ok  = replay_process<sharded_backend>( "sharded", input, check_every ) && is_ok;
+        is_run = true;
+    }
+
+    if( is_all || strcmp( backend_name, "snapshot" ) == 0 )
+    {
+        is_ok  = replay_process<snapshot_backend>( "snapshot", input, check_every ) && is_ok;
+        is_run = true;
+    }
+
+    if( !is_run )
+    {
+        fprintf( stderr, "unknown backend %s\n", backend_name );
+        return 1;
+    }
+
+    return is_ok ? 0 : 2;
+}
@@ -6,228 +6,931 @@
                    Sorting of endpoints -> O(n*logn)
                    Segment tree construction -> O(n)
                    Tree update after each insertion or deletion -> O(logn)
-  Method used: Segment tree construction
+  Method used: Segment tree construction (segment_tree.h)
+               Implicit heap layout (structure of arrays), preallocated once,
+               iterative bottom-up insertion and deletion
+  Batch mode (-b, -r k, -f): commands are read in blocks and parsed by hand, tree
+               updates are deferred to the next reported result so that an interval
+               inserted and deleted in between is never traversed, results are
+               written through a single output buffer
+  Window query (Q a b): covered length inside [a, b], a and b are mapped to elementary
+               segments by binary search, then only the O(logn) canonical nodes are visited
+  Stabbing query (S x): # of intervals containing x from the counts on one root-to-leaf
+               path in O(logn), with -s the ids from per-node lists in O(logn+k),
+               an interval is unlisted in O(logn) through back-pointers to its entries
+  Coverage depth (-c k): every node also keeps the length covered by >= j intervals
+               stored below it for j<=k and the max depth below it, O(k*logn) per update
+  Snapshot readers (-m q): one writer applies the commands and publishes an immutable
+               snapshot after each of them, q monitor threads poll the union length and
+               a window length of the latest snapshot without locks; snapshots share the
+               unchanged node blocks through a persistent radix index of pages, a publish
+               copies only the changed blocks and the pages on their paths (none if the
+               command changed nothing), and a snapshot is reclaimed once no reader holds
+               an epoch at or before its retirement, freeing only the pages it alone held
+               (concurrent_segment_tree.h)
+  Sharded mode (-t p): the elementary segments are split into 4p shards of equal size,
+               each with its own tree and lock, an interval spanning shards is split at
+               the shard boundaries and the union length is the sum of the shard roots,
+               read once the producers are done; p producer threads apply the commands,
+               each owning the intervals with id%p equal to its index
+               (concurrent_segment_tree.h)
 
  ************************************************************************************/
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 #include <vector>
 
+#include "segment_tree.h"
+#include "concurrent_segment_tree.h"
+
 #define NDEBUG
 #define PRECISION 0.000001
+#define IO_BLOCK_SIZE (1<<16) // bytes read or written at once in batch mode
+#define SHARDS_PER_PRODUCER 4  // more shards than producers keeps lock contention low
+#define MAX_LATENCY_SAMPLE (1<<22) // latencies recorded per monitor thread
 
 // --------------- class definition --------------- //
 
-// endpoint of an interval
-class endpoint
+// main tree, keeps the coverage-depth augmentation for -c k
+typedef segment_tree< double, depth_augment<double> > depth_tree;
+
+// entry of an id list, k tells which canonical node of the interval the list belongs to
+class stab_entry
 {
     public:
-        void init( double v, int id, bool b ) { value = v; interval_id = id; is_left = b; }
+        stab_entry( unsigned id, unsigned k ) { interval_id = id; canonical_k = k; }
 
-        double value;       // endpoint coordinate, real value
-        int    interval_id; // id of interval_set
-        bool   is_left;     // true if left endpoint, false if right endpoint
+        unsigned interval_id;
+        unsigned canonical_k;
 };
 
-class interval
+// stabbing index next to the segment tree
+// endCount[m] counts the applied intervals whose right endpoint maps to m, so that a point on
+// an endpoint is answered without counting an interval twice; with keep_ids every node (and
+// every right endpoint, bucket 2*leaf_base+m) also lists the ids of the intervals stored there
+class stab_index
 {
     public:
-        interval(void) { left_x=0; right_x=0; is_zeroLength = false; }
+        stab_index(void) { keep_ids = false; }
+
+        std::vector<unsigned> endCount; // (use +1 offset)
 
-        double   rLeft_x, rRight_x; // real left x, real right x 
-        double   rLength;           // rRight_x minus rLeft_x
-        bool     is_zeroLength;
-        unsigned left_x, right_x;   // left x and right x after transformation
+        bool keep_ids;
+        std::vector< std::vector<stab_entry> > bucket; // ids stored at a node or a right endpoint
+        std::vector< std::vector<unsigned> >   slot;   // slot[id][k]: position of id in its k-th bucket
 };
 
-// tree node of the segment tree
-class node
+// block reader for the command stream of batch mode, parsing without scanf
+class input_buffer
 {
     public:
-        node(void) 
-        { 
-            key            = 0;
-            leftChild_id   = 0; 
-            rightChild_id  = 0; 
-            intervalCount  = 0; 
-            subtreeRLength = 0.0;
+        input_buffer( FILE *f ) { file = f; pos = 0; len = 0; buffer.resize( IO_BLOCK_SIZE ); }
+
+        // next character, EOF if the stream is exhausted
+        int get( void )
+        {
+            if( pos == len )
+            {
+                len = fread( &(buffer[0]), 1, IO_BLOCK_SIZE, file );
+                pos = 0;
+
+                if( len == 0 )
+                    return EOF;
+            }
+
+            return static_cast<unsigned char>( buffer[pos++] );
         }
 
-        unsigned key;
-        double   rLeft_x, rRight_x; // real left x, real right x
-        double   rLength;           // rRight_x-rLeft_x
-        unsigned left_x, right_x; 
-        unsigned parent_id;    // 0 if it is root
-        unsigned leftChild_id, rightChild_id;
+        FILE             *file;
+        std::vector<char> buffer;
+        size_t            pos, len;
+};
 
-        unsigned intervalCount;
-        double subtreeRLength; // interval length of the subtree
+// single output buffer for batch mode, flushed in blocks
+class output_buffer
+{
+    public:
+        output_buffer( FILE *f ) { file = f; len = 0; buffer.resize( IO_BLOCK_SIZE ); }
+        ~output_buffer( void ) { flush(); }
+
+        void flush( void ) { fwrite( &(buffer[0]), 1, len, file ); len = 0; }
+
+        // reserve room for one record of at most n bytes
+        char *reserve( size_t n )
+        {
+            if( len+n > IO_BLOCK_SIZE )
+                flush();
+
+            return &(buffer[len]);
+        }
+
+        FILE             *file;
+        std::vector<char> buffer;
+        size_t            len;
+};
+
+// one command of the input stream
+class command
+{
+    public:
+        char     instruction; // 'I', 'D', 'Q' or 'S'
+        unsigned target_id;   // interval id of I<n> or D<n>
+        double   rArg[2];     // real arguments, Q a b asks for the covered length in window [a, b]
+                              // and S x for the intervals containing point x
 };
 
 // --------------- function declaration --------------- //
 
-bool cmp_small_epVal( const endpoint &e1, const endpoint &e2 );
+void report_length( double length );
+
+void stab_construct( stab_index &stab, const depth_tree &tree, unsigned interval_no, unsigned global_max_x, bool keep_ids );
+
+void stab_push( stab_index &stab, unsigned bucket_id, unsigned target_id, unsigned k );
+
+void stab_insertion( unsigned target_id, const interval<double> &target, const depth_tree &tree, stab_index &stab );
+
+void stab_deletion( unsigned target_id, const interval<double> &target, const depth_tree &tree, stab_index &stab );
+
+void stab_collect( const stab_index &stab, unsigned bucket_id, std::vector<unsigned> &stab_id );
+
+unsigned stab_query( const depth_tree &tree, const stab_index &stab, const std::vector<double> &map_to_real,
+                     unsigned global_max_x, double x, std::vector<unsigned> &stab_id );
+
+void report_stab( unsigned count, const std::vector<unsigned> &stab_id );
+
+void report_result( const depth_tree &tree, const std::vector<double> &map_to_real );
+
+bool next_real( input_buffer &in, double &value );
 
-void tree_update( unsigned cur_id, std::vector<node> &segment_tree, double interval_length );
+bool next_command( input_buffer &in, command &cmd );
 
-void interval_deletion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, std::vector<node> &segment_tree );
+void write_length( output_buffer &out, double length );
 
-void interval_insertion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, std::vector<node> &segment_tree );
+void write_stab( output_buffer &out, unsigned count, const std::vector<unsigned> &stab_id );
 
-void report_result( node &root );
+size_t format_length( char *dst, double length );
 
-void tree_construct( std::vector<node> &segment_tree );
+void write_result( output_buffer &out, const depth_tree &tree, const std::vector<double> &map_to_real );
+
+void tree_flush( std::vector<unsigned> &dirty_set, std::vector<bool> &is_dirty, std::vector<bool> &in_tree,
+                 const std::vector<unsigned> &interval_count, const std::vector< interval<double> > &interval_set,
+                 depth_tree &tree, stab_index &stab );
+
+void batch_process( const std::vector< interval<double> > &interval_set, const std::vector<double> &map_to_real, unsigned global_max_x,
+                    depth_tree &tree, stab_index &stab, unsigned report_every, bool final_only );
+
+void producer_process( const std::vector<command> &command_set, const std::vector< interval<double> > &interval_set,
+                       std::vector<unsigned> &interval_count, sharded_tree &forest );
+
+void sharded_process( const std::vector< interval<double> > &interval_set, const std::vector<double> &map_to_real, unsigned global_max_x,
+                      unsigned producer_no );
+
+void monitor_process( unsigned reader_id, snapshot_domain &domain, const std::vector<double> &map_to_real, unsigned global_max_x,
+                      const std::atomic<bool> &is_done, std::vector<double> &latency );
+
+void snapshot_process( const std::vector< interval<double> > &interval_set, const std::vector<double> &map_to_real, unsigned global_max_x,
+                       unsigned reader_no );
 
 using std::vector;
 
 // --------------- function definition --------------- //
 
-bool cmp_small_epVal( const endpoint &e1, const endpoint &e2 )
+void report_length( double length )
 {
-    return ( e1.value < e2.value );
+    if( fabs(length) > PRECISION )
+        printf( "%lf\n", length );
+    else
+        printf( "0.000000\n" );
 }
 
-// update towards root after insertion
-void tree_update( unsigned cur_id, vector<node> &segment_tree, double interval_length )
+// one bucket per node and one per mapped coordinate
+void stab_construct( stab_index &stab, const depth_tree &tree, unsigned interval_no, unsigned global_max_x, bool keep_ids )
 {
-    // has been inserted or hit the root
-    if( segment_tree[cur_id].intervalCount > 0 || cur_id == 1 )
-    {
-        segment_tree[cur_id].subtreeRLength += interval_length;
-        return;
-    }
-    else
+    stab.endCount.assign( global_max_x+1, 0 );
+    stab.keep_ids = keep_ids;
+
+    if( keep_ids )
     {
-        segment_tree[cur_id].subtreeRLength += interval_length;
-        tree_update( segment_tree[cur_id].parent_id, segment_tree, interval_length );
+        stab.bucket.resize( 2*tree.leaf_base + global_max_x+1 );
+        stab.slot.resize( interval_no+1 );
     }
 
     return;
 }
 
-void interval_deletion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, vector<node> &segment_tree )
+inline void stab_push( stab_index &stab, unsigned bucket_id, unsigned target_id, unsigned k )
+{
+    stab.slot[target_id].push_back( stab.bucket[bucket_id].size() );
+    stab.bucket[bucket_id].push_back( stab_entry( target_id, k ) );
+}
+
+// list an applied interval at its canonical nodes (same order as interval_insertion) and its right endpoint
+void stab_insertion( unsigned target_id, const interval<double> &target, const depth_tree &tree, stab_index &stab )
 {
-    if( (target_left_x <= segment_tree[cur_id].left_x) && (target_right_x >= segment_tree[cur_id].right_x) )
+    (stab.endCount[target.right_x])++;
+
+    if( !stab.keep_ids )
+        return;
+
+    unsigned left_id  = tree.leaf_base + target.left_x - 1;
+    unsigned right_id = tree.leaf_base + target.right_x - 1;
+    unsigned k = 0;
+
+    assert( stab.slot[target_id].empty() );
+
+    for( ; left_id < right_id; left_id >>= 1, right_id >>= 1 )
     {
-        assert( segment_tree[cur_id].intervalCount > 0 );
-        (segment_tree[cur_id].intervalCount)--;
+        if( left_id & 1 )
+            stab_push( stab, left_id++, target_id, k++ );
 
-        if( segment_tree[cur_id].intervalCount == 0 && cur_id != 1 )
-            tree_update( segment_tree[cur_id].parent_id, segment_tree, segment_tree[cur_id].subtreeRLength-segment_tree[cur_id].rLength );
+        if( right_id & 1 )
+            stab_push( stab, --right_id, target_id, k++ );
+    }
+
+    stab_push( stab, 2*tree.leaf_base + target.right_x, target_id, k );
+
+    return;
+}
 
+// unlist an interval, each entry is swapped with the last one of its bucket in O(1)
+void stab_deletion( unsigned target_id, const interval<double> &target, const depth_tree &tree, stab_index &stab )
+{
+    assert( stab.endCount[target.right_x] > 0 );
+    (stab.endCount[target.right_x])--;
+
+    if( !stab.keep_ids )
         return;
+
+    unsigned left_id  = tree.leaf_base + target.left_x - 1;
+    unsigned right_id = tree.leaf_base + target.right_x - 1;
+    vector<unsigned> bucket_id;
+
+    for( ; left_id < right_id; left_id >>= 1, right_id >>= 1 )
+    {
+        if( left_id & 1 )
+            bucket_id.push_back( left_id++ );
+
+        if( right_id & 1 )
+            bucket_id.push_back( --right_id );
     }
 
-    if( target_left_x < segment_tree[cur_id].key )
-        interval_deletion( target_left_x, target_right_x, segment_tree[cur_id].leftChild_id, segment_tree );
+    bucket_id.push_back( 2*tree.leaf_base + target.right_x );
+    assert( bucket_id.size() == stab.slot[target_id].size() );
+
+    for( unsigned k=0; k<bucket_id.size(); ++k )
+    {
+        vector<stab_entry> &cur_bucket = stab.bucket[bucket_id[k]];
+        unsigned pos = stab.slot[target_id][k];
+        const stab_entry &moved = cur_bucket.back();
+
+        stab.slot[moved.interval_id][moved.canonical_k] = pos;
+        cur_bucket[pos] = moved;
+        cur_bucket.pop_back();
+    }
 
-    if( target_right_x > segment_tree[cur_id].key )
-        interval_deletion( target_left_x, target_right_x, segment_tree[cur_id].rightChild_id, segment_tree );
+    stab.slot[target_id].clear();
 
     return;
 }
 
-// insert an interval and do update towards root
-void interval_insertion( unsigned target_left_x, unsigned target_right_x, unsigned cur_id, vector<node> &segment_tree )
+void stab_collect( const stab_index &stab, unsigned bucket_id, vector<unsigned> &stab_id )
 {
-    if( (target_left_x <= segment_tree[cur_id].left_x) && (target_right_x >= segment_tree[cur_id].right_x) )
+    const vector<stab_entry> &cur_bucket = stab.bucket[bucket_id];
+
+    for( unsigned i=0; i<cur_bucket.size(); ++i )
+        stab_id.push_back( cur_bucket[i].interval_id );
+}
+
+// # of applied intervals [l, r] with l <= x <= r in O(logn), their ids in O(logn+k) if kept
+// x on a mapped coordinate m is contained by the intervals covering the elementary segment
+// to its right plus the ones ending at m, which are disjoint sets
+unsigned stab_query( const depth_tree &tree, const stab_index &stab, const vector<double> &map_to_real,
+                     unsigned global_max_x, double x, vector<unsigned> &stab_id )
+{
+    stab_id.clear();
+
+    const double *first = &(map_to_real[1]);
+    const double *last  = first + global_max_x;
+    const double *near  = std::lower_bound( first, last, x-PRECISION );
+
+    unsigned segment_no = global_max_x - 1;
+    unsigned leaf_id;   // elementary segment containing x or starting at x
+    unsigned count = 0;
+
+    if( near != last && fabs( *near-x ) <= PRECISION )
     {
-        if( segment_tree[cur_id].intervalCount == 0 && cur_id != 1 )
-            tree_update( segment_tree[cur_id].parent_id, segment_tree, segment_tree[cur_id].rLength-segment_tree[cur_id].subtreeRLength );
+        unsigned mapped_x = near - first + 1;
+        count += stab.endCount[mapped_x];
 
-        (segment_tree[cur_id].intervalCount)++;
-        return;
+        if( stab.keep_ids )
+            stab_collect( stab, 2*tree.leaf_base + mapped_x, stab_id );
+
+        leaf_id = mapped_x - 1;
     }
+    else if( near == first || near == last )
+        return 0;
+    else
+        leaf_id = near - first - 1;
 
-    if( target_left_x < segment_tree[cur_id].key )
-        interval_insertion( target_left_x, target_right_x, segment_tree[cur_id].leftChild_id, segment_tree );
+    if( leaf_id >= segment_no )
+        return count;
 
-    if( target_right_x > segment_tree[cur_id].key )
-        interval_insertion( target_left_x, target_right_x, segment_tree[cur_id].rightChild_id, segment_tree );
+    for( unsigned cur_id = tree.leaf_base+leaf_id; cur_id > 0; cur_id >>= 1 )
+    {
+        count += tree.intervalCount[cur_id];
 
-    return;
+        if( stab.keep_ids )
+            stab_collect( stab, cur_id, stab_id );
+    }
+
+    return count;
 }
 
-void report_result( node &root )
+// count followed by the ids if they are kept
+void report_stab( unsigned count, const vector<unsigned> &stab_id )
 {
-    if( root.intervalCount == 0 )
+    printf( "%u", count );
+
+    for( unsigned i=0; i<stab_id.size(); ++i )
+        printf( " %u", stab_id[i] );
+
+    printf( "\n" );
+}
+
+// with coverage depth: union length, length covered by >= k intervals, max depth and
+// the leftmost elementary segment of max depth (empty segment at the domain start if depth is 0)
+void report_result( const depth_tree &tree, const vector<double> &map_to_real )
+{
+    double length = covered_length( tree, 1 );
+
+    if( fabs(length) > PRECISION )
+        printf( "%lf", length );
+    else
+        printf( "0.000000" );
+
+    if( tree.augment.coverage_k > 0 )
     {
-        if( fabs(root.subtreeRLength) > PRECISION )
-            printf( "%lf\n", root.subtreeRLength );
+        unsigned depth   = tree.intervalCount[1] + tree.augment.maxDepth[1];
+        unsigned leaf_id = max_depth_leaf( tree ) - tree.leaf_base;
+
+        if( depth == 0 )
+            printf( " %lf 0 %lf %lf", 0.0, map_to_real[1], map_to_real[1] );
         else
-            printf( "0.000000\n" );
+            printf( " %lf %u %lf %lf", depth_length( tree, 1, tree.augment.coverage_k ), depth, map_to_real[leaf_id+1], map_to_real[leaf_id+2] );
+    }
+
+    printf( "\n" );
+}
+
+// parse the next whitespace separated real, false if the stream is exhausted
+bool next_real( input_buffer &in, double &value )
+{
+    int c = in.get();
+
+    while( c != EOF && (c == ' ' || c == '\n' || c == '\r' || c == '\t') )
+        c = in.get();
+
+    char   token[64];
+    size_t len = 0;
+
+    for( ; c != EOF && c != ' ' && c != '\n' && c != '\r' && c != '\t'; c = in.get() )
+    {
+        if( len < sizeof(token)-1 )
+            token[len++] = static_cast<char>(c);
+    }
+
+    token[len] = '\0';
+    value = strtod( token, NULL );
+
+    return len > 0;
+}
+
+// parse the next command, e.g. I3, D3 or Q 1.5 7, false if the stream is exhausted
+bool next_command( input_buffer &in, command &cmd )
+{
+    int c = in.get();
+
+    while( c != EOF && (c == ' ' || c == '\n' || c == '\r' || c == '\t') )
+        c = in.get();
+
+    if( c == EOF )
+        return false;
+
+    cmd.instruction = static_cast<char>(c);
+    cmd.target_id   = 0;
+
+    if( cmd.instruction == 'Q' )
+        return next_real( in, cmd.rArg[0] ) && next_real( in, cmd.rArg[1] );
+
+    if( cmd.instruction == 'S' )
+        return next_real( in, cmd.rArg[0] );
+
+    for( c = in.get(); c >= '0' && c <= '9'; c = in.get() )
+        cmd.target_id = cmd.target_id*10 + static_cast<unsigned>(c-'0');
+
+    return true;
+}
+
+// same text as printf( "%lf", length ), without the printf machinery in the common case
+size_t format_length( char *dst, double length )
+{
+    double scaled = length * 1000000.0;
+    double frac   = scaled - floor( scaled );
+
+    // negative, huge or too close to a rounding tie to decide from the scaled value
+    if( !(length >= 0.0) || scaled > 1e13 || fabs( frac-0.5 ) < 0.01 )
+        return snprintf( dst, 64, "%lf", length );
+
+    unsigned long long fixed = static_cast<unsigned long long>( floor( scaled+0.5 ) );
+    char   digits[24];
+    size_t digit_no = 0;
+
+    for( ; fixed > 0 || digit_no < 7; fixed /= 10 )
+        digits[digit_no++] = static_cast<char>( '0' + fixed%10 );
+
+    size_t len = 0;
+
+    while( digit_no > 6 )
+        dst[len++] = digits[--digit_no];
+
+    dst[len++] = '.';
+
+    while( digit_no > 0 )
+        dst[len++] = digits[--digit_no];
+
+    return len;
+}
+
+// same text as report_length
+void write_length( output_buffer &out, double length )
+{
+    char *dst = out.reserve( 64 );
+
+    if( fabs(length) > PRECISION )
+        out.len += format_length( dst, length );
+    else
+    {
+        memcpy( dst, "0.000000", 8 );
+        out.len += 8;
+    }
+
+    out.buffer[out.len++] = '\n';
+}
+
+// same text as report_stab
+void write_stab( output_buffer &out, unsigned count, const vector<unsigned> &stab_id )
+{
+    char *dst = out.reserve( 16 );
+    out.len += snprintf( dst, 16, "%u", count );
+
+    for( unsigned i=0; i<stab_id.size(); ++i )
+    {
+        dst = out.reserve( 16 );
+        out.len += snprintf( dst, 16, " %u", stab_id[i] );
     }
+
+    dst = out.reserve( 1 );
+    dst[0] = '\n';
+    out.len++;
+}
+
+// same text as report_result
+void write_result( output_buffer &out, const depth_tree &tree, const vector<double> &map_to_real )
+{
+    double length = covered_length( tree, 1 );
+    char *dst = out.reserve( 256 );
+
+    if( fabs(length) > PRECISION )
+        out.len += format_length( dst, length );
     else
     {
-        if( fabs(root.rLength) > PRECISION )
-            printf( "%lf\n", root.rLength );
+        memcpy( dst, "0.000000", 8 );
+        out.len += 8;
+    }
+
+    if( tree.augment.coverage_k > 0 )
+    {
+        unsigned depth   = tree.intervalCount[1] + tree.augment.maxDepth[1];
+        unsigned leaf_id = max_depth_leaf( tree ) - tree.leaf_base;
+        dst = &(out.buffer[out.len]);
+
+        if( depth == 0 )
+            out.len += snprintf( dst, 192, " %lf 0 %lf %lf", 0.0, map_to_real[1], map_to_real[1] );
         else
-            printf( "0.000000\n" );
+            out.len += snprintf( dst, 192, " %lf %u %lf %lf", depth_length( tree, 1, tree.augment.coverage_k ), depth,
+                                 map_to_real[leaf_id+1], map_to_real[leaf_id+2] );
     }
+
+    out.buffer[out.len++] = '\n';
 }
 
-// construct segment tree
-void tree_construct( vector<node> &segment_tree, vector<double> &map_to_real )
+// bring the tree in line with interval_count, only intervals touched since the last flush are visited
+// an interval inserted and deleted again in between costs no traversal at all
+void tree_flush( vector<unsigned> &dirty_set, vector<bool> &is_dirty, vector<bool> &in_tree,
+                 const vector<unsigned> &interval_count, const vector< interval<double> > &interval_set,
+                 depth_tree &tree, stab_index &stab )
 {
-    unsigned key, tree_size, right_id; // temporary variables
+    for( unsigned i=0; i<dirty_set.size(); ++i )
+    {
+        unsigned target_id = dirty_set[i];
+        bool     expected  = (interval_count[target_id] > 0);
+        const interval<double> &target = interval_set[target_id];
+        is_dirty[target_id] = false;
+
+        if( expected == in_tree[target_id] )
+            continue;
+
+        if( expected )
+        {
+            if( !(target.is_zeroLength) )
+                interval_insertion( target.left_x, target.right_x, tree );
+
+            stab_insertion( target_id, target, tree, stab );
+        }
+        else
+        {
+            if( !(target.is_zeroLength) )
+                interval_deletion( target.left_x, target.right_x, tree );
+
+            stab_deletion( target_id, target, tree, stab );
+        }
 
-    for( unsigned i=1; i<segment_tree.size(); ++i )
+        in_tree[target_id] = expected;
+    }
+
+    dirty_set.clear();
+
+    return;
+}
+
+// read the command stream in blocks, defer tree updates to the next reported result
+// and write every report_every-th result (or only the final one) through one output buffer
+void batch_process( const vector< interval<double> > &interval_set, const vector<double> &map_to_real, unsigned global_max_x,
+                    depth_tree &tree, stab_index &stab, unsigned report_every, bool final_only )
+{
+    input_buffer  in( stdin );
+    output_buffer out( stdout );
+
+    vector<unsigned> interval_count( interval_set.size(), 0 ); // (use +1 offset)
+    vector<bool>     in_tree( interval_set.size(), false );    // interval is applied to the tree now
+    vector<bool>     is_dirty( interval_set.size(), false );
+    vector<unsigned> dirty_set;                                // intervals touched since last flush
+
+    command          cmd;
+    unsigned         command_no = 0; // # of I/D commands so far
+    vector<unsigned> stab_id;
+
+    while( next_command( in, cmd ) )
+    {
+        char     instruction = cmd.instruction;
+        unsigned target_id   = cmd.target_id;
+
+        // queries are always answered, on the tree brought up to date
+        if( instruction == 'Q' )
+        {
+            tree_flush( dirty_set, is_dirty, in_tree, interval_count, interval_set, tree, stab );
+            write_length( out, window_length( tree, map_to_real, global_max_x, cmd.rArg[0], cmd.rArg[1] ) );
+            continue;
+        }
+
+        if( instruction == 'S' )
+        {
+            tree_flush( dirty_set, is_dirty, in_tree, interval_count, interval_set, tree, stab );
+            unsigned count = stab_query( tree, stab, map_to_real, global_max_x, cmd.rArg[0], stab_id );
+            write_stab( out, count, stab_id );
+            continue;
+        }
+
+        command_no++;
+
+        if( target_id == 0 || target_id >= interval_set.size() )
+            continue;
+
+        if( instruction == 'I' )
+            interval_count[target_id]++;
+        else
+        {
+            assert( instruction == 'D' );
+
+            if( interval_count[target_id] == 0 )
+            {
+                if( final_only )
+                    continue;
+
+                // still a command of the count, its report is due as for any other
+                if( report_every > 1 )
+                {
+                    if( command_no % report_every == 0 )
+                    {
+                        tree_flush( dirty_set, is_dirty, in_tree, interval_count, interval_set, tree, stab );
+                        write_result( out, tree, map_to_real );
+                    }
+
+                    continue;
+                }
+
+                char *dst = out.reserve( 32 );
+                out.len += snprintf( dst, 32, "S%u not inserted yet\n", target_id );
+                continue;
+            }
+
+            interval_count[target_id]--;
+        }
+
+        if( !is_dirty[target_id] )
+        {
+            is_dirty[target_id] = true;
+            dirty_set.push_back( target_id );
+        }
+
+        if( !final_only && command_no % report_every == 0 )
+        {
+            tree_flush( dirty_set, is_dirty, in_tree, interval_count, interval_set, tree, stab );
+            write_result( out, tree, map_to_real );
+        }
+    }
+
+    if( final_only )
+    {
+        tree_flush( dirty_set, is_dirty, in_tree, interval_count, interval_set, tree, stab );
+        write_result( out, tree, map_to_real );
+    }
+
+    return;
+}
+
+// apply the commands of one producer, it is the only writer of interval_count of its intervals
+void producer_process( const vector<command> &command_set, const vector< interval<double> > &interval_set,
+                       vector<unsigned> &interval_count, sharded_tree &forest )
+{
+    for( unsigned i=0; i<command_set.size(); ++i )
     {
-        if( (segment_tree[i].right_x - segment_tree[i].left_x) <= 1 )
+        unsigned target_id = command_set[i].target_id;
+        const interval<double> &target = interval_set[target_id];
+
+        if( command_set[i].instruction == 'I' )
         {
-            // leaf does not need to calculate key value, default is 0
-            assert( (segment_tree[i].right_x - segment_tree[i].left_x) == 1 );
-            assert( segment_tree[i].leftChild_id == 0 && segment_tree[i].rightChild_id == 0 );
+            if( interval_count[target_id] == 0 && !(target.is_zeroLength) )
+                sharded_update( target.left_x, target.right_x, true, forest );
+
+            interval_count[target_id]++;
+        }
+        else if( interval_count[target_id] > 0 )
+        {
+            if( interval_count[target_id] == 1 && !(target.is_zeroLength) )
+                sharded_update( target.left_x, target.right_x, false, forest );
+
+            interval_count[target_id]--;
+        }
+    }
+
+    return;
+}
+
+// read all commands, hand them to producer_no threads by interval id and report the final union length
+void sharded_process( const vector< interval<double> > &interval_set, const vector<double> &map_to_real, unsigned global_max_x,
+                      unsigned producer_no )
+{
+    sharded_tree forest( producer_no*SHARDS_PER_PRODUCER );
+    sharded_construct( forest, map_to_real, global_max_x );
+
+    input_buffer in( stdin );
+    command      cmd;
+    vector< vector<command> > command_set( producer_no );
+    unsigned     command_no = 0;
+
+    while( next_command( in, cmd ) )
+    {
+        // queries need a quiescent tree, they are not served in this mode
+        if( (cmd.instruction != 'I' && cmd.instruction != 'D') || cmd.target_id == 0 || cmd.target_id >= interval_set.size() )
             continue;
+
+        command_set[cmd.target_id % producer_no].push_back( cmd );
+        command_no++;
+    }
+
+    vector<unsigned>         interval_count( interval_set.size(), 0 ); // (use +1 offset)
+    vector<std::thread>      producer_set;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for( unsigned p=0; p<producer_no; ++p )
+        producer_set.push_back( std::thread( producer_process, std::cref(command_set[p]), std::cref(interval_set),
+                                             std::ref(interval_count), std::ref(forest) ) );
+
+    for( unsigned p=0; p<producer_no; ++p )
+        producer_set[p].join();
+
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now()-start ).count();
+
+    report_length( sharded_length( forest ) );
+    fprintf( stderr, "%u producers, %u commands, %.0lf commands/s\n", producer_no, command_no,
+             (seconds > 0.0) ? command_no/seconds : 0.0 );
+
+    return;
+}
+
+// poll the union length and the covered length of the middle half of the domain until the writer is done
+void monitor_process( unsigned reader_id, snapshot_domain &domain, const vector<double> &map_to_real, unsigned global_max_x,
+                      const std::atomic<bool> &is_done, vector<double> &latency )
+{
+    double window_left  = map_to_real[1] + (map_to_real[global_max_x]-map_to_real[1])/4;
+    double window_right = map_to_real[global_max_x] - (map_to_real[global_max_x]-map_to_real[1])/4;
+    double checksum     = 0.0;
+
+    while( !is_done.load() )
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        const tree_snapshot *snapshot = snapshot_acquire( domain, reader_id );
+        checksum += snapshot_length( *snapshot );
+        checksum += window_length( *snapshot, map_to_real, global_max_x, window_left, window_right );
+        snapshot_release( domain, reader_id );
+
+        if( latency.size() < MAX_LATENCY_SAMPLE )
+            latency.push_back( std::chrono::duration<double>( std::chrono::steady_clock::now()-start ).count() );
+    }
+
+    assert( checksum >= 0.0 );
+
+    return;
+}
+
+// one writer thread applies all commands and publishes a snapshot after each of them while
+// reader_no monitors poll; reports the final union length and the reader latencies on stderr
+void snapshot_process( const vector< interval<double> > &interval_set, const vector<double> &map_to_real, unsigned global_max_x,
+                       unsigned reader_no )
+{
+    depth_tree tree;
+    tree_construct( tree, map_to_real, global_max_x );
+
+    snapshot_domain domain( reader_no );
+    snapshot_publish( tree, domain );
+
+    input_buffer     in( stdin );
+    command          cmd;
+    vector<command>  command_set;
+
+    while( next_command( in, cmd ) )
+    {
+        if( (cmd.instruction == 'I' || cmd.instruction == 'D') && cmd.target_id > 0 && cmd.target_id < interval_set.size() )
+            command_set.push_back( cmd );
+    }
+
+    std::atomic<bool>        is_done( false );
+    vector< vector<double> > latency( reader_no );
+    vector<std::thread>      monitor_set;
+
+    for( unsigned r=0; r<reader_no; ++r )
+        monitor_set.push_back( std::thread( monitor_process, r, std::ref(domain), std::cref(map_to_real), global_max_x,
+                                            std::cref(is_done), std::ref(latency[r]) ) );
+
+    vector<unsigned> interval_count( interval_set.size(), 0 ); // (use +1 offset)
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for( unsigned i=0; i<command_set.size(); ++i )
+    {
+        unsigned target_id = command_set[i].target_id;
+        const interval<double> &target = interval_set[target_id];
+
+        if( command_set[i].instruction == 'I' )
+        {
+            if( interval_count[target_id] == 0 && !(target.is_zeroLength) )
+            {
+                interval_insertion( target.left_x, target.right_x, tree );
+                snapshot_mark( target.left_x, target.right_x, tree, domain );
+            }
+
+            interval_count[target_id]++;
+        }
+        else if( interval_count[target_id] > 0 )
+        {
+            if( interval_count[target_id] == 1 && !(target.is_zeroLength) )
+            {
+                interval_deletion( target.left_x, target.right_x, tree );
+                snapshot_mark( target.left_x, target.right_x, tree, domain );
+            }
+
+            interval_count[target_id]--;
         }
 
-        key = (segment_tree[i].left_x + segment_tree[i].right_x)/2;
-        segment_tree[i].key = key;
-
-        tree_size = segment_tree.size();
-        segment_tree.resize( tree_size+2 );
-        right_id = tree_size+1;
-
-        segment_tree[i].leftChild_id  = tree_size;
-        segment_tree[i].rightChild_id = right_id;
-
-        // construct left sub-tree
-        segment_tree[tree_size].rLeft_x   = map_to_real[segment_tree[i].left_x];
-        segment_tree[tree_size].rRight_x  = map_to_real[key];
-        segment_tree[tree_size].rLength   = segment_tree[tree_size].rRight_x - segment_tree[tree_size].rLeft_x;
-        segment_tree[tree_size].left_x    = segment_tree[i].left_x;
-        segment_tree[tree_size].right_x   = key;
-        segment_tree[tree_size].parent_id = i;
-
-        // construct right sub-tree
-        segment_tree[right_id].rLeft_x   = map_to_real[key];
-        segment_tree[right_id].rRight_x  = map_to_real[segment_tree[i].right_x];
-        segment_tree[right_id].rLength   = segment_tree[right_id].rRight_x - segment_tree[right_id].rLeft_x;
-        segment_tree[right_id].left_x    = key;
-        segment_tree[right_id].right_x   = segment_tree[i].right_x;
-        segment_tree[right_id].parent_id = i;
+        snapshot_publish( tree, domain );
+    }
+
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now()-start ).count();
+    is_done.store( true );
+
+    for( unsigned r=0; r<reader_no; ++r )
+        monitor_set[r].join();
+
+    assert( fabs( snapshot_length( *domain.current.load() ) - covered_length( tree, 1 ) ) < PRECISION );
+    report_length( snapshot_length( *domain.current.load() ) );
+    fprintf( stderr, "writer: %u commands, %.0lf commands/s\n", static_cast<unsigned>(command_set.size()),
+             (seconds > 0.0) ? command_set.size()/seconds : 0.0 );
+
+    for( unsigned r=0; r<reader_no; ++r )
+    {
+        if( latency[r].empty() )
+            continue;
+
+        std::sort( latency[r].begin(), latency[r].end() );
+        fprintf( stderr, "reader %u: %u polls, median %.3lf us, p99 %.3lf us, max %.3lf us\n", r,
+                 static_cast<unsigned>(latency[r].size()), latency[r][latency[r].size()/2]*1e6,
+                 latency[r][latency[r].size()*99/100]*1e6, latency[r].back()*1e6 );
     }
 
+    snapshot_reclaim( domain, true );
+
     return;
 }
 
 // --------------- main function --------------- //
 
+// usage: segment_tree [-b] [-r k] [-f] [-c k] [-s] [-t p] [-m q]
+//   -b   batch mode: block input, deferred tree updates, buffered output
+//   -r k report every k-th result only (implies -b)
+//   -f   report the final union length only (implies -b)
+//   -c k also report the length covered by >= k intervals, the max coverage depth
+//        and the leftmost elementary segment where it occurs
+//   -s   keep the ids of the stored intervals per node, so that S x also lists them
+//   -t p sharded tree updated by p producer threads, reports the final union length only
+//        and the throughput on stderr, queries are skipped (build with -pthread)
+//   -m q one writer publishing snapshots and q lock-free monitor threads, reports the final
+//        union length only and the writer throughput and reader latencies on stderr
+//   with -r or -f, deletions of intervals not inserted are skipped silently
+// besides I<n> and D<n>, the command "Q a b" reports the covered length inside the window [a, b]
+// and "S x" the # of inserted intervals containing x (followed by their ids with -s)
 int main( int argc, char **argv )
 {
     // freopen( "../interval_cases/case1.in", "r", stdin );
 
+    bool     batch_mode   = false;
+    bool     final_only   = false;
+    unsigned report_every = 1;
+    unsigned coverage_k   = 0;
+    bool     keep_ids     = false;
+    unsigned producer_no  = 0;
+    unsigned reader_no    = 0;
+
+    for( int i=1; i<argc; ++i )
+    {
+        if( strcmp( argv[i], "-b" ) == 0 )
+            batch_mode = true;
+        else if( strcmp( argv[i], "-f" ) == 0 )
+            batch_mode = final_only = true;
+        else if( strcmp( argv[i], "-r" ) == 0 && i+1 < argc )
+        {
+            batch_mode   = true;
+            report_every = static_cast<unsigned>(atoi( argv[++i] ));
+
+            if( report_every == 0 )
+                report_every = 1;
+        }
+        else if( strcmp( argv[i], "-t" ) == 0 && i+1 < argc )
+        {
+            producer_no = static_cast<unsigned>(atoi( argv[++i] ));
+
+            if( producer_no == 0 )
+                producer_no = 1;
+        }
+        else if( strcmp( argv[i], "-m" ) == 0 && i+1 < argc )
+        {
+            reader_no = static_cast<unsigned>(atoi( argv[++i] ));
+
+            if( reader_no == 0 )
+                reader_no = 1;
+        }
+        else if( strcmp( argv[i], "-s" ) == 0 )
+            keep_ids = true;
+        else if( strcmp( argv[i], "-c" ) == 0 && i+1 < argc )
+        {
+            coverage_k = static_cast<unsigned>(atoi( argv[++i] ));
+
+            if( coverage_k == 0 )
+                coverage_k = 1;
+        }
+        else
+        {
+            fprintf( stderr, "usage: %s [-b] [-r k] [-f] [-c k] [-s] [-t p] [-m q]\n", argv[0] );
+            return 1;
+        }
+    }
+
     unsigned interval_no;
 
     scanf( "%u", &interval_no );
 
-    vector<interval> interval_set; // all intervals (use +1 offset)
+    vector< interval<double> > interval_set; // all intervals (use +1 offset)
     interval_set.resize( interval_no+1 );
 
-    vector<endpoint> endpoint_set; // all endpoints (use no offset)
+    vector< endpoint<double> > endpoint_set; // all endpoints (use no offset)
     endpoint_set.resize( interval_no*2 );
 
     { // parse input intervals
@@ -252,81 +955,85 @@ int main( int argc, char **argv )
         interval_no-=1; // recover
     }
 
-    unsigned global_max_x; // max x of the mapped space, min x is 1
     vector<double> map_to_real; // mapped space to real value, (use +1 offset)
-    map_to_real.resize( interval_no*2+1 );
-
-    { // map the real space to integer space counting from integer 1
-        // sort in ascending order
-        std::sort( endpoint_set.begin(), endpoint_set.end(), cmp_small_epVal );
 
-        unsigned mapped_val = 1;
-        unsigned tmp_id = endpoint_set[0].interval_id;
-        map_to_real[1] = endpoint_set[0].value;
+    // map the real space to integer space counting from integer 1
+    unsigned global_max_x = compress_endpoints( endpoint_set, interval_set, map_to_real ); // max x of the mapped space, min x is 1
 
-        if( endpoint_set[0].is_left )
-            interval_set[tmp_id].left_x  = mapped_val;
-        else
-            interval_set[tmp_id].right_x = mapped_val;
+#ifndef NDEBUG
+    printf( "debug mapping..." );
 
-        unsigned endpoint_no = endpoint_set.size();
+    for( unsigned i=1; i<interval_no+1; ++i )
+        assert( interval_set[i].left_x > 0 && interval_set[i].right_x > 0 );
 
-        for( unsigned i=1; i<endpoint_no; ++i )
-        {
-            // if two real values are the same, they should map to the same integer
-            // otherwise, just map to next continuous integer
-            if( fabs( endpoint_set[i].value - endpoint_set[i-1].value ) > PRECISION )
-            {
-                mapped_val++;
-                map_to_real[mapped_val] = endpoint_set[i].value;
-            }
+    printf( "done!\n" );
+#endif
 
-            tmp_id = endpoint_set[i].interval_id;
 
-            if( endpoint_set[i].is_left )
-                interval_set[tmp_id].left_x  = mapped_val;
-            else
-                interval_set[tmp_id].right_x = mapped_val;
-        }
+    if( producer_no > 0 )
+    {
+        sharded_process( interval_set, map_to_real, global_max_x, producer_no );
+        return 0;
+    }
 
-#ifndef NDEBUG
-        printf( "debug mapping..." );
+    if( reader_no > 0 )
+    {
+        snapshot_process( interval_set, map_to_real, global_max_x, reader_no );
+        return 0;
+    }
 
-        for( unsigned i=1; i<interval_no+1; ++i )
-            assert( interval_set[i].left_x > 0 && interval_set[i].right_x > 0 );
+    depth_tree tree; // segment tree (use +1 offset)
+    tree.augment.coverage_k = coverage_k;
+    tree_construct( tree, map_to_real, global_max_x );
 
-        printf( "done!\n" );
-#endif 
-        global_max_x = mapped_val;
-    }
+    stab_index stab;
+    stab_construct( stab, tree, interval_no, global_max_x, keep_ids );
 
-    vector<node> segment_tree; // segment tree (use +1 offset)
-
-    { // construct segment tree
-        segment_tree.resize(2);
-        segment_tree[1].rLeft_x   = map_to_real[1];
-        segment_tree[1].rRight_x  = map_to_real[global_max_x];
-        segment_tree[1].rLength   = segment_tree[1].rRight_x - segment_tree[1].rLeft_x;
-        segment_tree[1].left_x    = 1;
-        segment_tree[1].right_x   = global_max_x;
-        segment_tree[1].parent_id = 0;
-        tree_construct( segment_tree, map_to_real ); 
+    if( batch_mode )
+    {
+        batch_process( interval_set, map_to_real, global_max_x, tree, stab, report_every, final_only );
+        return 0;
     }
 
     vector<unsigned> interval_count; // record the interval count being inserted (use +1 offset)
     interval_count.resize( interval_no+1, 0 );
 
     { // read the remainder input command to do insertion or deletion
-        char instruction;   // 'D' or 'I'    
+        char instruction;   // 'D', 'I', 'Q' or 'S'
         char command[20];   // ex. D3 - delete interval 3
         unsigned target_id; // target interval id
         unsigned target_left_x, target_right_x;
+        vector<unsigned> stab_id;
 
         while( scanf( "%s", command ) != EOF )
         {
             // printf( "command is %s\n", command );
 
             instruction = command[0];
+
+            if( instruction == 'Q' ) // window query: Q a b
+            {
+                double window_left, window_right;
+
+                if( scanf( "%lf %lf", &window_left, &window_right ) != 2 )
+                    break;
+
+                report_length( window_length( tree, map_to_real, global_max_x, window_left, window_right ) );
+                continue;
+            }
+
+            if( instruction == 'S' ) // stabbing query: S x
+            {
+                double x;
+
+                if( scanf( "%lf", &x ) != 1 )
+                    break;
+
+                unsigned count = stab_query( tree, stab, map_to_real, global_max_x, x, stab_id );
+                report_stab( count, stab_id );
+                continue;
+            }
+
             command[0] = '0';
             target_id = static_cast<unsigned>(atoi(command));
 
@@ -336,11 +1043,14 @@ int main( int argc, char **argv )
                 {
                     target_left_x  = interval_set[target_id].left_x;
                     target_right_x = interval_set[target_id].right_x;
-                    interval_insertion( target_left_x, target_right_x, 1, segment_tree );
+                    interval_insertion( target_left_x, target_right_x, tree );
                 }
 
+                if( interval_count[target_id]==0 )
+                    stab_insertion( target_id, interval_set[target_id], tree, stab );
+
                 interval_count[target_id]++;
-                report_result( segment_tree[1] );
+                report_result( tree, map_to_real );
             }
             else
             {
@@ -350,14 +1060,18 @@ int main( int argc, char **argv )
                 {
                     target_left_x  = interval_set[target_id].left_x;
                     target_right_x = interval_set[target_id].right_x;
-                    interval_deletion( target_left_x, target_right_x, 1, segment_tree );
+
+                    if( !(interval_set[target_id].is_zeroLength) )
+                        interval_deletion( target_left_x, target_right_x, tree );
+
+                    stab_deletion( target_id, interval_set[target_id], tree, stab );
                     interval_count[target_id]=0;
-                    report_result( segment_tree[1] );
+                    report_result( tree, map_to_real );
                 }
                 else if( interval_count[target_id]>1 )
                 {
                     interval_count[target_id]--;
-                    report_result( segment_tree[1] );
+                    report_result( tree, map_to_real );
                 }
                 else
                     printf( "S%u not inserted yet\n", target_id );
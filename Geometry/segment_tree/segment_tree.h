@@ -0,0 +1,887 @@
+/*************************************************************************************
+
+  Header-only segment tree over compressed interval endpoints, shared by
+  segment_tree.cpp and area_iso-oriented_rect/area_rec.cpp
+
+  segment_tree<coord_type, augment_type>
+    coord_type:   double (endpoints closer than PRECISION are merged) or an integer
+                  type (exact), lengths are kept in coord_type as well
+    augment_type: extra node data kept up to date on the update paths
+                  union_augment - nothing but the union length (default)
+                  depth_augment - length covered by >= j intervals for j<=k, max depth
+                  perimeter_augment - # of disjoint covered runs and whether the ends
+                                  of the node are covered, for union perimeters
+                  integral_augment - integral of the covered length over time (the
+                                  sweep height), for offline window areas; updated
+                                  top-down by integral_insertion/integral_deletion
+                                  only, ancestors covered meanwhile are pushed lazily
+                  twoset_augment - the intervals belong to set A or set B, length
+                                  covered by B and by both, for boolean areas;
+                                  updated by set_insertion/set_deletion
+  Layout: implicit heap order (root 1, children 2i and 2i+1), structure of arrays,
+          allocated once; insertion and deletion are iterative and bottom-up
+  Time complexity: construction O(n), insertion/deletion O(logn) (O(k*logn) with
+                   depth_augment), window query O(logn)
+
+ ************************************************************************************/
+
+#ifndef SEGMENT_TREE_H
+#define SEGMENT_TREE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#ifndef PRECISION
+#define PRECISION 0.000001
+#endif
+
+// --------------- class definition --------------- //
+
+// endpoint of an interval
+template <class coord_type>
+class endpoint
+{
+    public:
+        void init( coord_type v, int id, bool b ) { value = v; interval_id = id; is_left = b; }
+
+        coord_type value;       // endpoint coordinate, real value
+        int        interval_id; // id of interval_set
+        bool       is_left;     // true if left endpoint, false if right endpoint
+};
+
+template <class coord_type>
+class interval
+{
+    public:
+        interval(void) { left_x=0; right_x=0; is_zeroLength = false; }
+
+        coord_type rLeft_x, rRight_x; // real left x, real right x
+        coord_type rLength;           // rRight_x minus rLeft_x
+        bool       is_zeroLength;
+        unsigned   left_x, right_x;   // left x and right x after transformation
+};
+
+// no augmentation, the tree keeps the union length only
+class union_augment
+{
+    public:
+        void construct( unsigned ) {}
+
+        template <class tree_type>
+        void pull( tree_type &, unsigned ) {}
+};
+
+// coverage-depth augmentation, set coverage_k before tree_construct
+template <class coord_type>
+class depth_augment
+{
+    public:
+        depth_augment(void) { coverage_k = 0; }
+
+        void construct( unsigned tree_size );
+
+        template <class tree_type>
+        void pull( tree_type &tree, unsigned cur_id );
+
+        unsigned coverage_k;                  // largest depth j asked for, 0 keeps nothing
+        std::vector<coord_type> kRLength;     // [i*coverage_k+j-1]: length covered by >= j intervals stored below node i
+        std::vector<unsigned>   maxDepth;     // max # of intervals stored below node i over one elementary segment
+};
+
+// covered-run augmentation: # of maximal covered runs of the intervals stored below a node
+// and boundary flags telling whether its first and last elementary segments are covered
+class perimeter_augment
+{
+    public:
+        enum { LEFT_COVERED = 1, RIGHT_COVERED = 2 };
+
+        void construct( unsigned tree_size );
+
+        template <class tree_type>
+        void pull( tree_type &tree, unsigned cur_id );
+
+        std::vector<unsigned>      segmentCount; // # of disjoint covered runs below node i
+        std::vector<unsigned char> boundaryFlag; // LEFT_COVERED | RIGHT_COVERED below node i
+};
+
+// time-integral augmentation: the area swept by the covered length of a node, kept as of
+// the last time the node was visited, and the time its ancestors were covered since then
+template <class coord_type>
+class integral_augment
+{
+    public:
+        void construct( unsigned tree_size );
+
+        template <class tree_type>
+        void pull( tree_type &, unsigned ) {}
+
+        std::vector<coord_type> rArea;    // integral of the covered length of node i up to stamp[i]
+        std::vector<coord_type> stamp;    // time of the last visit of node i
+        std::vector<coord_type> pendTime; // time after stamp[i] with an ancestor of node i covered
+};
+
+// two-set augmentation: intervalCount counts the intervals of both sets, so the tree keeps the
+// union length of A and B as usual, and the B intervals are counted again on their own
+template <class coord_type>
+class twoset_augment
+{
+    public:
+        void construct( unsigned tree_size );
+
+        template <class tree_type>
+        void pull( tree_type &tree, unsigned cur_id );
+
+        std::vector<unsigned>   countB;      // # of B intervals stored at node i
+        std::vector<coord_type> bRLength;    // length covered by B intervals stored below node i
+        std::vector<coord_type> bothRLength; // length covered by A and B intervals stored below node i
+};
+
+// segment tree in implicit (heap ordered) layout, stored as structure of arrays
+// node i has children 2i and 2i+1 (use +1 offset, root is 1), leaves start at leaf_base
+// leaf leaf_base+j stands for the elementary segment [map_to_real[j+1], map_to_real[j+2]]
+template <class coord_type, class augment_type = union_augment>
+class segment_tree
+{
+    public:
+        segment_tree(void) { leaf_base = 1; }
+
+        unsigned leaf_base; // # of leaves, power of 2
+
+        std::vector<unsigned>   intervalCount;  // # of intervals stored at the node
+        std::vector<coord_type> rLength;        // real length spanned by the node
+        std::vector<coord_type> subtreeRLength; // union length of the intervals stored below the node
+
+        augment_type augment;
+};
+
+// --------------- function declaration --------------- //
+
+template <class coord_type>
+bool cmp_small_epVal( const endpoint<coord_type> &e1, const endpoint<coord_type> &e2 );
+
+bool same_coord( double v1, double v2 );
+
+template <class coord_type>
+bool same_coord( coord_type v1, coord_type v2 );
+
+template <class coord_type>
+unsigned compress_endpoints( std::vector< endpoint<coord_type> > &endpoint_set, std::vector< interval<coord_type> > &interval_set,
+                             std::vector<coord_type> &map_to_real );
+
+template <class coord_type, class augment_type>
+coord_type covered_length( const segment_tree<coord_type, augment_type> &tree, unsigned cur_id );
+
+template <class coord_type, class augment_type>
+unsigned node_count( const segment_tree<coord_type, augment_type> &tree, unsigned cur_id );
+
+template <class coord_type, class augment_type>
+coord_type node_subtree_length( const segment_tree<coord_type, augment_type> &tree, unsigned cur_id );
+
+template <class coord_type>
+coord_type depth_length( const segment_tree< coord_type, depth_augment<coord_type> > &tree, unsigned cur_id, unsigned depth );
+
+template <class coord_type>
+unsigned max_depth_leaf( const segment_tree< coord_type, depth_augment<coord_type> > &tree );
+
+template <class coord_type>
+unsigned covered_segment( const segment_tree<coord_type, perimeter_augment> &tree, unsigned cur_id );
+
+template <class coord_type>
+unsigned covered_boundary( const segment_tree<coord_type, perimeter_augment> &tree, unsigned cur_id );
+
+template <class coord_type>
+coord_type setB_length( const segment_tree< coord_type, twoset_augment<coord_type> > &tree, unsigned cur_id );
+
+template <class coord_type>
+coord_type both_length( const segment_tree< coord_type, twoset_augment<coord_type> > &tree, unsigned cur_id );
+
+template <class coord_type, class augment_type>
+void tree_update( unsigned cur_id, segment_tree<coord_type, augment_type> &tree );
+
+template <class coord_type, class augment_type>
+void interval_deletion( unsigned target_left_x, unsigned target_right_x, segment_tree<coord_type, augment_type> &tree );
+
+template <class coord_type, class augment_type>
+void interval_insertion( unsigned target_left_x, unsigned target_right_x, segment_tree<coord_type, augment_type> &tree );
+
+template <class coord_type, class augment_type>
+void tree_construct( segment_tree<coord_type, augment_type> &tree, const std::vector<coord_type> &map_to_real, unsigned global_max_x );
+
+template <class coord_type>
+void set_insertion( unsigned target_left_x, unsigned target_right_x, bool is_setB,
+                    segment_tree< coord_type, twoset_augment<coord_type> > &tree );
+
+template <class coord_type>
+void set_deletion( unsigned target_left_x, unsigned target_right_x, bool is_setB,
+                   segment_tree< coord_type, twoset_augment<coord_type> > &tree );
+
+template <class tree_type, class coord_type>
+coord_type range_length( const tree_type &tree, const std::vector<coord_type> &map_to_real, unsigned cur_id,
+                         unsigned low, unsigned high, unsigned target_low, unsigned target_high );
+
+template <class tree_type>
+bool is_leaf_covered( const tree_type &tree, unsigned leaf_id );
+
+template <class tree_type>
+void uncovered_report( const tree_type &tree, unsigned cur_id, unsigned low, unsigned high, unsigned target_low,
+                       unsigned target_high, std::vector< std::pair<unsigned, unsigned> > &piece_set );
+
+template <class tree_type, class coord_type>
+coord_type window_length( const tree_type &tree, const std::vector<coord_type> &map_to_real, unsigned global_max_x,
+                          coord_type window_left, coord_type window_right );
+
+template <class coord_type>
+void integral_push( segment_tree< coord_type, integral_augment<coord_type> > &tree, unsigned cur_id, coord_type time );
+
+template <class coord_type>
+void integral_update( segment_tree< coord_type, integral_augment<coord_type> > &tree, unsigned cur_id, unsigned low, unsigned high,
+                      unsigned target_low, unsigned target_high, coord_type time, bool is_insertion );
+
+template <class coord_type>
+void integral_insertion( unsigned target_left_x, unsigned target_right_x, coord_type time,
+                         segment_tree< coord_type, integral_augment<coord_type> > &tree );
+
+template <class coord_type>
+void integral_deletion( unsigned target_left_x, unsigned target_right_x, coord_type time,
+                        segment_tree< coord_type, integral_augment<coord_type> > &tree );
+
+template <class coord_type>
+coord_type integral_range( segment_tree< coord_type, integral_augment<coord_type> > &tree, unsigned cur_id, unsigned low,
+                           unsigned high, unsigned target_low, unsigned target_high, coord_type time );
+
+template <class coord_type>
+coord_type window_integral( segment_tree< coord_type, integral_augment<coord_type> > &tree, const std::vector<coord_type> &map_to_real,
+                            unsigned global_max_x, coord_type window_left, coord_type window_right, coord_type time );
+
+// --------------- function definition --------------- //
+
+template <class coord_type>
+bool cmp_small_epVal( const endpoint<coord_type> &e1, const endpoint<coord_type> &e2 )
+{
+    return ( e1.value < e2.value );
+}
+
+// real coordinates closer than PRECISION are the same point
+inline bool same_coord( double v1, double v2 )
+{
+    return !( fabs( v1-v2 ) > PRECISION );
+}
+
+// integer coordinates are compared exactly
+template <class coord_type>
+inline bool same_coord( coord_type v1, coord_type v2 )
+{
+    return ( v1 == v2 );
+}
+
+// map the real space to integer space counting from integer 1, sets left_x/right_x of
+// every interval and map_to_real (use +1 offset), returns max x of the mapped space
+template <class coord_type>
+unsigned compress_endpoints( std::vector< endpoint<coord_type> > &endpoint_set, std::vector< interval<coord_type> > &interval_set,
+                             std::vector<coord_type> &map_to_real )
+{
+    map_to_real.resize( endpoint_set.size()+1 );
+
+    if( endpoint_set.empty() )
+        return 1;
+
+    // sort in ascending order
+    std::sort( endpoint_set.begin(), endpoint_set.end(), cmp_small_epVal<coord_type> );
+
+    unsigned mapped_val = 1;
+    unsigned tmp_id = endpoint_set[0].interval_id;
+    map_to_real[1] = endpoint_set[0].value;
+
+    if( endpoint_set[0].is_left )
+        interval_set[tmp_id].left_x  = mapped_val;
+    else
+        interval_set[tmp_id].right_x = mapped_val;
+
+    unsigned endpoint_no = endpoint_set.size();
+
+    for( unsigned i=1; i<endpoint_no; ++i )
+    {
+        // if two real values are the same, they should map to the same integer
+        // otherwise, just map to next continuous integer
+        if( !same_coord( endpoint_set[i].value, endpoint_set[i-1].value ) )
+        {
+            mapped_val++;
+            map_to_real[mapped_val] = endpoint_set[i].value;
+        }
+
+        tmp_id = endpoint_set[i].interval_id;
+
+        if( endpoint_set[i].is_left )
+            interval_set[tmp_id].left_x  = mapped_val;
+        else
+            interval_set[tmp_id].right_x = mapped_val;
+    }
+
+    return mapped_val;
+}
+
+template <class coord_type>
+void depth_augment<coord_type>::construct( unsigned tree_size )
+{
+    if( coverage_k == 0 )
+        return;
+
+    kRLength.assign( static_cast<size_t>(tree_size)*coverage_k, 0 );
+    maxDepth.assign( tree_size, 0 );
+}
+
+template <class coord_type>
+template <class tree_type>
+void depth_augment<coord_type>::pull( tree_type &tree, unsigned cur_id )
+{
+    if( coverage_k == 0 )
+        return;
+
+    unsigned left_id = 2*cur_id, right_id = 2*cur_id+1;
+    coord_type *k_length = &(kRLength[cur_id*coverage_k]);
+
+    for( unsigned depth=1; depth<=coverage_k; ++depth )
+        k_length[depth-1] = depth_length( tree, left_id, depth ) + depth_length( tree, right_id, depth );
+
+    maxDepth[cur_id] = std::max( tree.intervalCount[left_id]+maxDepth[left_id], tree.intervalCount[right_id]+maxDepth[right_id] );
+}
+
+inline void perimeter_augment::construct( unsigned tree_size )
+{
+    segmentCount.assign( tree_size, 0 );
+    boundaryFlag.assign( tree_size, 0 );
+}
+
+// two runs touching at the middle of the node are one run
+template <class tree_type>
+void perimeter_augment::pull( tree_type &tree, unsigned cur_id )
+{
+    unsigned left_id = 2*cur_id, right_id = 2*cur_id+1;
+    unsigned left_flag  = covered_boundary( tree, left_id );
+    unsigned right_flag = covered_boundary( tree, right_id );
+
+    segmentCount[cur_id] = covered_segment( tree, left_id ) + covered_segment( tree, right_id );
+
+    if( (left_flag & RIGHT_COVERED) && (right_flag & LEFT_COVERED) )
+        segmentCount[cur_id]--;
+
+    boundaryFlag[cur_id] = (left_flag & LEFT_COVERED) | (right_flag & RIGHT_COVERED);
+}
+
+template <class coord_type>
+void integral_augment<coord_type>::construct( unsigned tree_size )
+{
+    rArea.assign( tree_size, 0 );
+    stamp.assign( tree_size, 0 );
+    pendTime.assign( tree_size, 0 );
+}
+
+template <class coord_type>
+void twoset_augment<coord_type>::construct( unsigned tree_size )
+{
+    countB.assign( tree_size, 0 );
+    bRLength.assign( tree_size, 0 );
+    bothRLength.assign( tree_size, 0 );
+}
+
+// a node covered by one set only holds both where the other set covers its subtree,
+// A below a node is its union minus B plus both
+template <class coord_type>
+template <class tree_type>
+void twoset_augment<coord_type>::pull( tree_type &tree, unsigned cur_id )
+{
+    unsigned left_id = 2*cur_id, right_id = 2*cur_id+1;
+
+    bRLength[cur_id]    = setB_length( tree, left_id ) + setB_length( tree, right_id );
+    bothRLength[cur_id] = both_length( tree, left_id ) + both_length( tree, right_id );
+}
+
+// union length of the intervals stored at or below the node
+template <class coord_type, class augment_type>
+inline coord_type covered_length( const segment_tree<coord_type, augment_type> &tree, unsigned cur_id )
+{
+    if( tree.intervalCount[cur_id] > 0 )
+        return tree.rLength[cur_id];
+    else
+        return tree.subtreeRLength[cur_id];
+}
+
+// node accessors shared by the queries on the tree and on views of it
+template <class coord_type, class augment_type>
+inline unsigned node_count( const segment_tree<coord_type, augment_type> &tree, unsigned cur_id )
+{
+    return tree.intervalCount[cur_id];
+}
+
+template <class coord_type, class augment_type>
+inline coord_type node_subtree_length( const segment_tree<coord_type, augment_type> &tree, unsigned cur_id )
+{
+    return tree.subtreeRLength[cur_id];
+}
+
+// length covered by >= depth intervals stored at or below the node, depth in [1, coverage_k]
+template <class coord_type>
+inline coord_type depth_length( const segment_tree< coord_type, depth_augment<coord_type> > &tree, unsigned cur_id, unsigned depth )
+{
+    unsigned count = tree.intervalCount[cur_id];
+
+    if( count >= depth )
+        return tree.rLength[cur_id];
+    else // leaves keep all zero
+        return tree.augment.kRLength[cur_id*tree.augment.coverage_k + depth-count-1];
+}
+
+// leaf of the leftmost elementary segment with the maximum coverage depth
+template <class coord_type>
+unsigned max_depth_leaf( const segment_tree< coord_type, depth_augment<coord_type> > &tree )
+{
+    const std::vector<unsigned> &max_depth = tree.augment.maxDepth;
+    unsigned cur_id = 1;
+
+    while( cur_id < tree.leaf_base )
+    {
+        unsigned left_id = 2*cur_id, right_id = 2*cur_id+1;
+
+        if( tree.intervalCount[left_id]+max_depth[left_id] >= tree.intervalCount[right_id]+max_depth[right_id] )
+            cur_id = left_id;
+        else
+            cur_id = right_id;
+    }
+
+    return cur_id;
+}
+
+// # of disjoint covered runs of the intervals stored at or below the node
+template <class coord_type>
+inline unsigned covered_segment( const segment_tree<coord_type, perimeter_augment> &tree, unsigned cur_id )
+{
+    if( tree.intervalCount[cur_id] > 0 )
+        return 1;
+    else
+        return tree.augment.segmentCount[cur_id];
+}
+
+// boundary flags of the intervals stored at or below the node
+template <class coord_type>
+inline unsigned covered_boundary( const segment_tree<coord_type, perimeter_augment> &tree, unsigned cur_id )
+{
+    if( tree.intervalCount[cur_id] > 0 )
+        return perimeter_augment::LEFT_COVERED | perimeter_augment::RIGHT_COVERED;
+    else
+        return tree.augment.boundaryFlag[cur_id];
+}
+
+// length covered by the B intervals stored at or below the node
+template <class coord_type>
+inline coord_type setB_length( const segment_tree< coord_type, twoset_augment<coord_type> > &tree, unsigned cur_id )
+{
+    if( tree.augment.countB[cur_id] > 0 )
+        return tree.rLength[cur_id];
+    else
+        return tree.augment.bRLength[cur_id];
+}
+
+// length covered by both an A and a B interval stored at or below the node
+template <class coord_type>
+inline coord_type both_length( const segment_tree< coord_type, twoset_augment<coord_type> > &tree, unsigned cur_id )
+{
+    const twoset_augment<coord_type> &augment = tree.augment;
+    unsigned count_b = augment.countB[cur_id], count_a = tree.intervalCount[cur_id] - count_b;
+
+    if( count_a > 0 && count_b > 0 )
+        return tree.rLength[cur_id];
+    else if( count_a > 0 ) // covered by A, both where B covers below
+        return augment.bRLength[cur_id];
+    else if( count_b > 0 ) // covered by B, both where A covers below
+        return tree.subtreeRLength[cur_id] - augment.bRLength[cur_id] + augment.bothRLength[cur_id];
+    else
+        return augment.bothRLength[cur_id];
+}
+
+// update towards root after insertion or deletion at the children of the path
+template <class coord_type, class augment_type>
+void tree_update( unsigned cur_id, segment_tree<coord_type, augment_type> &tree )
+{
+    for( cur_id >>= 1; cur_id > 0; cur_id >>= 1 )
+    {
+        tree.subtreeRLength[cur_id] = covered_length( tree, 2*cur_id ) + covered_length( tree, 2*cur_id+1 );
+        tree.augment.pull( tree, cur_id );
+    }
+
+    return;
+}
+
+// delete an interval bottom-up, [target_left_x, target_right_x] are mapped coordinates
+template <class coord_type, class augment_type>
+void interval_deletion( unsigned target_left_x, unsigned target_right_x, segment_tree<coord_type, augment_type> &tree )
+{
+    unsigned left_id  = tree.leaf_base + target_left_x - 1;  // first leaf covered
+    unsigned right_id = tree.leaf_base + target_right_x - 1; // one past the last leaf covered
+
+    if( left_id >= right_id )
+        return;
+
+    unsigned first_leaf = left_id, last_leaf = right_id-1;
+
+    for( ; left_id < right_id; left_id >>= 1, right_id >>= 1 )
+    {
+        if( left_id & 1 )
+        {
+            assert( tree.intervalCount[left_id] > 0 );
+            (tree.intervalCount[left_id++])--;
+        }
+
+        if( right_id & 1 )
+        {
+            assert( tree.intervalCount[right_id-1] > 0 );
+            (tree.intervalCount[--right_id])--;
+        }
+    }
+
+    tree_update( first_leaf, tree );
+    tree_update( last_leaf, tree );
+
+    return;
+}
+
+// insert an interval bottom-up and do update towards root
+template <class coord_type, class augment_type>
+void interval_insertion( unsigned target_left_x, unsigned target_right_x, segment_tree<coord_type, augment_type> &tree )
+{
+    unsigned left_id  = tree.leaf_base + target_left_x - 1;  // first leaf covered
+    unsigned right_id = tree.leaf_base + target_right_x - 1; // one past the last leaf covered
+
+    if( left_id >= right_id )
+        return;
+
+    unsigned first_leaf = left_id, last_leaf = right_id-1;
+
+    for( ; left_id < right_id; left_id >>= 1, right_id >>= 1 )
+    {
+        if( left_id & 1 )
+            (tree.intervalCount[left_id++])++;
+
+        if( right_id & 1 )
+            (tree.intervalCount[--right_id])++;
+    }
+
+    tree_update( first_leaf, tree );
+    tree_update( last_leaf, tree );
+
+    return;
+}
+
+// construct segment tree, all nodes are allocated at once
+template <class coord_type, class augment_type>
+void tree_construct( segment_tree<coord_type, augment_type> &tree, const std::vector<coord_type> &map_to_real, unsigned global_max_x )
+{
+    unsigned segment_no = global_max_x - 1; // # of elementary segments
+
+    tree.leaf_base = 1;
+
+    while( tree.leaf_base < segment_no )
+        tree.leaf_base <<= 1;
+
+    unsigned tree_size = 2*tree.leaf_base;
+    tree.intervalCount.assign( tree_size, 0 );
+    tree.rLength.assign( tree_size, 0 );
+    tree.subtreeRLength.assign( tree_size, 0 );
+    tree.augment.construct( tree_size );
+
+    // node i of a level starting at first_id spans the leaves [(i-first_id)*span, (i-first_id+1)*span)
+    // padding leaves beyond segment_no have zero length
+    for( unsigned first_id = tree.leaf_base, span = 1; first_id > 0; first_id >>= 1, span <<= 1 )
+    {
+        for( unsigned i=first_id; i<2*first_id; ++i )
+        {
+            unsigned left_x  = std::min( (i-first_id)*span, segment_no ) + 1;
+            unsigned right_x = std::min( (i-first_id+1)*span, segment_no ) + 1;
+            tree.rLength[i]  = map_to_real[right_x] - map_to_real[left_x];
+        }
+    }
+
+    return;
+}
+
+// a B interval is counted at its canonical nodes before the insertion updates the paths
+template <class coord_type>
+void set_insertion( unsigned target_left_x, unsigned target_right_x, bool is_setB,
+                    segment_tree< coord_type, twoset_augment<coord_type> > &tree )
+{
+    if( is_setB )
+    {
+        for( unsigned left_id = tree.leaf_base+target_left_x-1, right_id = tree.leaf_base+target_right_x-1; left_id < right_id; left_id >>= 1, right_id >>= 1 )
+        {
+            if( left_id & 1 )
+                (tree.augment.countB[left_id++])++;
+
+            if( right_id & 1 )
+                (tree.augment.countB[--right_id])++;
+        }
+    }
+
+    interval_insertion( target_left_x, target_right_x, tree );
+
+    return;
+}
+
+template <class coord_type>
+void set_deletion( unsigned target_left_x, unsigned target_right_x, bool is_setB,
+                   segment_tree< coord_type, twoset_augment<coord_type> > &tree )
+{
+    if( is_setB )
+    {
+        for( unsigned left_id = tree.leaf_base+target_left_x-1, right_id = tree.leaf_base+target_right_x-1; left_id < right_id; left_id >>= 1, right_id >>= 1 )
+        {
+            if( left_id & 1 )
+            {
+                assert( tree.augment.countB[left_id] > 0 );
+                (tree.augment.countB[left_id++])--;
+            }
+
+            if( right_id & 1 )
+            {
+                assert( tree.augment.countB[right_id-1] > 0 );
+                (tree.augment.countB[--right_id])--;
+            }
+        }
+    }
+
+    interval_deletion( target_left_x, target_right_x, tree );
+
+    return;
+}
+
+// covered length of the leaves [target_low, target_high) below the node spanning the leaves [low, high)
+// only the O(logn) canonical nodes of the leaf range and their ancestors are visited
+template <class tree_type, class coord_type>
+coord_type range_length( const tree_type &tree, const std::vector<coord_type> &map_to_real, unsigned cur_id,
+                         unsigned low, unsigned high, unsigned target_low, unsigned target_high )
+{
+    if( target_high <= low || high <= target_low )
+        return 0;
+
+    // covered as a whole, leaf p starts at map_to_real[p+1]
+    if( node_count( tree, cur_id ) > 0 )
+        return map_to_real[std::min( high, target_high )+1] - map_to_real[std::max( low, target_low )+1];
+
+    if( target_low <= low && high <= target_high )
+        return node_subtree_length( tree, cur_id );
+
+    unsigned mid = (low+high)/2;
+
+    return range_length( tree, map_to_real, 2*cur_id, low, mid, target_low, target_high )
+         + range_length( tree, map_to_real, 2*cur_id+1, mid, high, target_low, target_high );
+}
+
+// true if some interval stored on the path from the leaf to the root covers it
+template <class tree_type>
+bool is_leaf_covered( const tree_type &tree, unsigned leaf_id )
+{
+    for( unsigned cur_id = tree.leaf_base+leaf_id; cur_id > 0; cur_id >>= 1 )
+    {
+        if( node_count( tree, cur_id ) > 0 )
+            return true;
+    }
+
+    return false;
+}
+
+// append the maximal uncovered runs of the leaves [target_low, target_high) below the node spanning
+// the leaves [low, high), left to right; a node is only entered if it holds both covered and
+// uncovered leaves of the range, O(logn) per run
+template <class tree_type>
+void uncovered_report( const tree_type &tree, unsigned cur_id, unsigned low, unsigned high, unsigned target_low,
+                       unsigned target_high, std::vector< std::pair<unsigned, unsigned> > &piece_set )
+{
+    if( target_high <= low || high <= target_low || node_count( tree, cur_id ) > 0 )
+        return;
+
+    if( !(node_subtree_length( tree, cur_id ) > 0) ) // nothing stored below
+    {
+        unsigned piece_low = std::max( low, target_low ), piece_high = std::min( high, target_high );
+
+        if( !piece_set.empty() && piece_set.back().second == piece_low )
+            piece_set.back().second = piece_high;
+        else
+            piece_set.push_back( std::make_pair( piece_low, piece_high ) );
+
+        return;
+    }
+
+    unsigned mid = (low+high)/2;
+    uncovered_report( tree, 2*cur_id, low, mid, target_low, target_high, piece_set );
+    uncovered_report( tree, 2*cur_id+1, mid, high, target_low, target_high, piece_set );
+}
+
+// covered length inside the real window [window_left, window_right]
+// the window is mapped to the leaves lying fully inside it by binary search on map_to_real,
+// the two partially overlapped leaves at the ends are added separately
+template <class tree_type, class coord_type>
+coord_type window_length( const tree_type &tree, const std::vector<coord_type> &map_to_real, unsigned global_max_x,
+                          coord_type window_left, coord_type window_right )
+{
+    if( global_max_x < 2 )
+        return 0;
+
+    window_left  = std::max( window_left, map_to_real[1] );
+    window_right = std::min( window_right, map_to_real[global_max_x] );
+
+    if( !(window_left < window_right) )
+        return 0;
+
+    const coord_type *first = &(map_to_real[1]);
+    const coord_type *last  = first + global_max_x;
+
+    // leaves [full_low, full_high) lie inside the window
+    unsigned full_low  = std::lower_bound( first, last, window_left ) - first;
+    unsigned full_high = std::upper_bound( first, last, window_right ) - first - 1;
+
+    // window inside a single leaf
+    if( full_low > full_high )
+        return is_leaf_covered( tree, full_high ) ? window_right-window_left : 0;
+
+    coord_type length = range_length( tree, map_to_real, 1, 0, tree.leaf_base, full_low, full_high );
+
+    if( window_left < first[full_low] && is_leaf_covered( tree, full_low-1 ) )
+        length += first[full_low] - window_left;
+
+    if( window_right > first[full_high] && is_leaf_covered( tree, full_high ) )
+        length += window_right - first[full_high];
+
+    return length;
+}
+
+// bring the node up to time: since its stamp the node was covered as a whole while an ancestor
+// or the node itself was, otherwise its covered length was the one below, which only changes
+// on visits; the covered time is handed down to the children
+template <class coord_type>
+inline void integral_push( segment_tree< coord_type, integral_augment<coord_type> > &tree, unsigned cur_id, coord_type time )
+{
+    integral_augment<coord_type> &augment = tree.augment;
+    coord_type span = time - augment.stamp[cur_id];
+    coord_type covered_time = ( tree.intervalCount[cur_id] > 0 ) ? span : augment.pendTime[cur_id];
+
+    augment.rArea[cur_id] += covered_time * tree.rLength[cur_id] + (span-covered_time) * tree.subtreeRLength[cur_id];
+    augment.stamp[cur_id]    = time;
+    augment.pendTime[cur_id] = 0;
+
+    if( cur_id < tree.leaf_base )
+    {
+        augment.pendTime[2*cur_id]   += covered_time;
+        augment.pendTime[2*cur_id+1] += covered_time;
+    }
+}
+
+// insert or delete the leaves [target_low, target_high) at time below the node spanning the leaves [low, high)
+// every node visited is pushed first, so the change only counts from time on
+template <class coord_type>
+void integral_update( segment_tree< coord_type, integral_augment<coord_type> > &tree, unsigned cur_id, unsigned low, unsigned high,
+                      unsigned target_low, unsigned target_high, coord_type time, bool is_insertion )
+{
+    if( target_high <= low || high <= target_low )
+        return;
+
+    integral_push( tree, cur_id, time );
+
+    if( target_low <= low && high <= target_high )
+    {
+        if( is_insertion )
+            (tree.intervalCount[cur_id])++;
+        else
+        {
+            assert( tree.intervalCount[cur_id] > 0 );
+            (tree.intervalCount[cur_id])--;
+        }
+
+        return;
+    }
+
+    unsigned mid = (low+high)/2;
+    integral_update( tree, 2*cur_id, low, mid, target_low, target_high, time, is_insertion );
+    integral_update( tree, 2*cur_id+1, mid, high, target_low, target_high, time, is_insertion );
+
+    tree.subtreeRLength[cur_id] = covered_length( tree, 2*cur_id ) + covered_length( tree, 2*cur_id+1 );
+
+    return;
+}
+
+// [target_left_x, target_right_x] are mapped coordinates, time never decreases between calls
+template <class coord_type>
+void integral_insertion( unsigned target_left_x, unsigned target_right_x, coord_type time,
+                         segment_tree< coord_type, integral_augment<coord_type> > &tree )
+{
+    integral_update( tree, 1, 0, tree.leaf_base, target_left_x-1, target_right_x-1, time, true );
+}
+
+template <class coord_type>
+void integral_deletion( unsigned target_left_x, unsigned target_right_x, coord_type time,
+                        segment_tree< coord_type, integral_augment<coord_type> > &tree )
+{
+    integral_update( tree, 1, 0, tree.leaf_base, target_left_x-1, target_right_x-1, time, false );
+}
+
+// area swept up to time by the covered length of the leaves [target_low, target_high)
+template <class coord_type>
+coord_type integral_range( segment_tree< coord_type, integral_augment<coord_type> > &tree, unsigned cur_id, unsigned low,
+                           unsigned high, unsigned target_low, unsigned target_high, coord_type time )
+{
+    if( target_high <= low || high <= target_low )
+        return 0;
+
+    integral_push( tree, cur_id, time );
+
+    if( target_low <= low && high <= target_high )
+        return tree.augment.rArea[cur_id];
+
+    unsigned mid = (low+high)/2;
+
+    return integral_range( tree, 2*cur_id, low, mid, target_low, target_high, time )
+         + integral_range( tree, 2*cur_id+1, mid, high, target_low, target_high, time );
+}
+
+// area swept up to time inside the real window [window_left, window_right], as window_length
+// a leaf is covered as a whole or not at all, so a partially overlapped leaf at an end of the
+// window adds the overlapped share of its area
+template <class coord_type>
+coord_type window_integral( segment_tree< coord_type, integral_augment<coord_type> > &tree, const std::vector<coord_type> &map_to_real,
+                            unsigned global_max_x, coord_type window_left, coord_type window_right, coord_type time )
+{
+    if( global_max_x < 2 )
+        return 0;
+
+    window_left  = std::max( window_left, map_to_real[1] );
+    window_right = std::min( window_right, map_to_real[global_max_x] );
+
+    if( !(window_left < window_right) )
+        return 0;
+
+    const coord_type *first = &(map_to_real[1]);
+    const coord_type *last  = first + global_max_x;
+
+    // leaves [full_low, full_high) lie inside the window
+    unsigned full_low  = std::lower_bound( first, last, window_left ) - first;
+    unsigned full_high = std::upper_bound( first, last, window_right ) - first - 1;
+
+    // window inside a single leaf
+    if( full_low > full_high )
+        return integral_range( tree, 1, 0, tree.leaf_base, full_high, full_high+1, time )
+               * (window_right-window_left) / (first[full_high+1]-first[full_high]);
+
+    coord_type area = integral_range( tree, 1, 0, tree.leaf_base, full_low, full_high, time );
+
+    if( window_left < first[full_low] )
+        area += integral_range( tree, 1, 0, tree.leaf_base, full_low-1, full_low, time )
+                * (first[full_low]-window_left) / (first[full_low]-first[full_low-1]);
+
+    if( window_right > first[full_high] )
+        area += integral_range( tree, 1, 0, tree.leaf_base, full_high, full_high+1, time )
+                * (window_right-first[full_high]) / (first[full_high+1]-first[full_high]);
+
+    return area;
+}
+
+#endif
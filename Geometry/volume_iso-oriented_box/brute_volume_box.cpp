@@ -0,0 +1,95 @@
+/*************************************************************************************
+
+   Input: set of n boxes, in the format of volume_box.cpp
+   Output: volume of union of the input boxes, to check volume_box.cpp on small cases
+   Time complexity: O(n^4), where n is # of boxes
+      The distinct x, y and z endpoints cut the space into O(n^3) voxels, every voxel
+      is tested against every box -> O(n^4)
+   Method: coordinate compression, a voxel is covered iff its center lies in a box
+
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+// --------------- class definition --------------- //
+
+class box
+{
+    public:
+        double low[3], high[3]; // x, y, z
+};
+
+// --------------- function declaration --------------- //
+
+void sorted_unique( std::vector<double> &value );
+
+using std::vector;
+
+// --------------- function definition --------------- //
+
+void sorted_unique( vector<double> &value )
+{
+    std::sort( value.begin(), value.end() );
+    value.erase( std::unique( value.begin(), value.end() ), value.end() );
+}
+
+// --------------- main function --------------- //
+
+int main( int argc, char **argv )
+{
+    unsigned box_no; // # of boxes
+
+    if( scanf( "%u", &box_no ) != 1 )
+        return 0;
+
+    vector<box>    box_set;
+    vector<double> axis[3]; // endpoints on each axis
+
+    for( unsigned i=0; i<box_no; ++i )
+    {
+        box b;
+
+        if( scanf( "%lf %lf %lf %lf %lf %lf", &b.low[0], &b.low[1], &b.low[2], &b.high[0], &b.high[1], &b.high[2] ) != 6 )
+            break;
+
+        box_set.push_back( b );
+
+        for( unsigned d=0; d<3; ++d )
+        {
+            axis[d].push_back( b.low[d] );
+            axis[d].push_back( b.high[d] );
+        }
+    }
+
+    for( unsigned d=0; d<3; ++d )
+        sorted_unique( axis[d] );
+
+    double volume = 0.0;
+
+    for( unsigned i=0; i+1<axis[0].size(); ++i )
+        for( unsigned j=0; j+1<axis[1].size(); ++j )
+            for( unsigned k=0; k+1<axis[2].size(); ++k )
+            {
+                double center[3] = { (axis[0][i]+axis[0][i+1])/2, (axis[1][j]+axis[1][j+1])/2, (axis[2][k]+axis[2][k+1])/2 };
+
+                for( unsigned b=0; b<box_set.size(); ++b )
+                {
+                    bool is_inside = true;
+
+                    for( unsigned d=0; d<3 && is_inside; ++d )
+                        is_inside = ( box_set[b].low[d] < center[d] && center[d] < box_set[b].high[d] );
+
+                    if( is_inside )
+                    {
+                        volume += (axis[0][i+1]-axis[0][i]) * (axis[1][j+1]-axis[1][j]) * (axis[2][k+1]-axis[2][k]);
+                        break;
+                    }
+                }
+            }
+
+    printf( "%lf\n", volume );
+
+    return 0;
+}
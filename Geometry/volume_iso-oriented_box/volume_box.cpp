@@ -0,0 +1,150 @@
+/*************************************************************************************
+
+   Input: set of n boxes, each "x1 y1 z1 x2 y2 z2" for [x1, x2]x[y1, y2]x[z1, z2]
+   Output: volume of union of the input boxes
+   Time complexity: O(n*sqrt(n)*logn), every z-event is an update of the online
+      structure costing O(k*logn+B*logn) for the k=O(sqrt(n)) y-slabs its box
+      reaches, B=sqrt(n) (see ../area_iso-oriented_rect/online_area_rec.cpp);
+      O(n*(sqrt(n)+logn)) when every cross-section is small against the union of
+      the active ones, as in packaging data; both against the O(n^2*logn) of
+      sweeping the active rectangles again at every z-event
+      Sorting z endpoints of boxes -> O(n*logn)
+   Method: plane sweep in z, the active cross-sections are kept in the online union
+      area structure (../area_iso-oriented_rect/online_area_rec.h); between two
+      z-events the union area is constant, so the volume grows by area*dz, and every
+      event only inserts or deletes its rectangle
+   Check: brute_volume_box.cpp counts the covered cells of the compressed grid
+
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "../area_iso-oriented_rect/online_area_rec.h"
+
+#define NDEBUG
+
+// --------------- class definition --------------- //
+
+class box
+{
+    public:
+        double left_x, bottom_y, low_z, right_x, up_y, high_z;
+};
+
+class z_event
+{
+    public:
+        double   height;   // z-coordinate
+        unsigned box_id;
+        bool     is_low;   // true if it is the low face of the box, otherwise the high one
+};
+
+// --------------- function declaration --------------- //
+
+bool cmp_small_zHeight( const z_event &e1, const z_event &e2 );
+
+double union_volume( const std::vector<box> &box_set );
+
+using std::vector;
+
+// --------------- function definition --------------- //
+
+// strict weak order for std::sort, events at one height may come in any order since no
+// volume is swept between them
+bool cmp_small_zHeight( const z_event &e1, const z_event &e2 )
+{
+    return ( e1.height < e2.height );
+}
+
+double union_volume( const vector<box> &box_set )
+{
+    vector<z_event> event_set;
+    event_set.reserve( 2*box_set.size() );
+
+    for( unsigned i=0; i<box_set.size(); ++i )
+    {
+        const box &b = box_set[i];
+
+        // zero volume, its cross-section would stay in the structure for nothing
+        if( b.high_z-b.low_z < PRECISION || b.right_x-b.left_x < PRECISION || b.up_y-b.bottom_y < PRECISION )
+            continue;
+
+        z_event event;
+        event.box_id = i;
+        event.height = b.low_z;
+        event.is_low = true;
+        event_set.push_back( event );
+        event.height = b.high_z;
+        event.is_low = false;
+        event_set.push_back( event );
+    }
+
+    std::sort( event_set.begin(), event_set.end(), cmp_small_zHeight );
+
+    online_area structure;
+    double      volume = 0.0;
+
+    for( unsigned i=0; i<event_set.size(); ++i )
+    {
+        if( i > 0 )
+            volume += structure.total_area * (event_set[i].height - event_set[i-1].height);
+
+        const box  &b = box_set[event_set[i].box_id];
+        online_rect rec;
+        rec.left_x   = b.left_x;
+        rec.bottom_y = b.bottom_y;
+        rec.right_x  = b.right_x;
+        rec.up_y     = b.up_y;
+
+        if( event_set[i].is_low )
+            rect_insertion( structure, rec );
+        else
+        {
+            bool is_found = rect_deletion( structure, rec );
+            assert( is_found );
+            (void)is_found;
+        }
+    }
+
+    return volume;
+}
+
+// --------------- main function --------------- //
+
+int main( int argc, char **argv )
+{
+    // freopen( "../box_cases/case1.in", "r", stdin );
+
+    unsigned box_no; // # of boxes
+
+    if( scanf( "%u", &box_no ) != 1 )
+        return 0;
+
+    vector<box> box_set( box_no ); // (use no offset)
+
+    for( unsigned i=0; i<box_no; ++i )
+    {
+        box &b = box_set[i];
+
+        if( scanf( "%lf %lf %lf %lf %lf %lf", &b.left_x, &b.bottom_y, &b.low_z, &b.right_x, &b.up_y, &b.high_z ) != 6 )
+        {
+            box_set.resize( i );
+            break;
+        }
+
+        assert( b.right_x >= b.left_x && b.up_y >= b.bottom_y && b.high_z >= b.low_z );
+    }
+
+    double volume = union_volume( box_set );
+
+    if( fabs(volume) > PRECISION )
+        printf( "%lf\n", volume );
+    else
+        printf( "0.000000\n" );
+
+    return 0;
+}